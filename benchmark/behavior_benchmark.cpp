@@ -0,0 +1,79 @@
+/*
+    Microbenchmarks of the behavior engine (Google Benchmark), run against
+    MockRobot so that no robot is needed.
+
+    Example: ./behavior_benchmark --benchmark_filter=Latency
+*/
+
+#include <benchmark/benchmark.h>
+
+#include "emotional_manager/behavior_engine.h"
+
+using namespace emotional_manager;
+
+static Emotion emotionAt(unsigned long i){
+    Emotion emotion;
+    emotion.valence = float(i % 201)/100 - 1;
+    emotion.arousal = float((i*7) % 201)/100 - 1;
+    emotion.name = "neutral";
+    return emotion;
+}
+
+static void BM_EyeColour(benchmark::State& state){
+    unsigned long i = 0;
+    while (state.KeepRunning()){
+        Emotion emotion = emotionAt(i++);
+        benchmark::DoNotOptimize(eyeColour(emotion.valence, emotion.arousal));
+    }
+}
+BENCHMARK(BM_EyeColour);
+
+static void BM_SpeechParameters(benchmark::State& state){
+    unsigned long i = 0;
+    while (state.KeepRunning()){
+        Emotion emotion = emotionAt(i++);
+        benchmark::DoNotOptimize(speechParameters(emotion.valence, emotion.arousal));
+    }
+}
+BENCHMARK(BM_SpeechParameters);
+
+static void BM_MotionKeyframes(benchmark::State& state){
+    unsigned long i = 0;
+    while (state.KeepRunning()){
+        Emotion emotion = emotionAt(i++);
+        MotionCommand motion = motionKeyframes(emotion.valence, emotion.arousal);
+        benchmark::DoNotOptimize(motion);
+    }
+}
+BENCHMARK(BM_MotionKeyframes);
+
+// Time from setEmotion() until the robot received the eyes and speech commands.
+static void BM_CommandLatency(benchmark::State& state){
+    MockRobot robot;
+    BehaviorEngine engine(robot, 0.0);
+    unsigned long i = 0;
+    while (state.KeepRunning()){
+        unsigned long commands = robot.commands();
+        engine.setEmotion(emotionAt(i++), false);
+        robot.waitForCommands(commands + 2);
+    }
+}
+BENCHMARK(BM_CommandLatency)->UseRealTime();
+
+// Bursts of updates as sent by emotion_manager.py, the engine coalesces them.
+static void BM_CommandRate(benchmark::State& state){
+    MockRobot robot;
+    BehaviorEngine engine(robot, state.range(0)/1000.0);
+    unsigned long i = 0;
+    while (state.KeepRunning()){
+        for (int j = 0; j < 100; ++j){
+            engine.setEmotion(emotionAt(i++));
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*100);
+    state.counters["commands"] = robot.commands();
+    state.counters["preempted"] = robot.preempted();
+}
+BENCHMARK(BM_CommandRate)->Arg(0)->Arg(10)->Arg(50)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,252 @@
+/*
+    Microbenchmarks of the vision kernels (Google Benchmark).
+
+    The kernels are timed on synthetic landmarks and frames, so the results
+    are reproducible without camera nor model files. Recorded inputs can be
+    added through the environment:
+      VISION_BENCH_IMAGE  image with one or more faces
+      VISION_BENCH_MODEL  shape_predictor_68_face_landmarks.dat
+
+    Example: ./vision_benchmark --benchmark_filter=FaceCues
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <dlib/opencv.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/image_processing/shape_predictor.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "emotional_manager/cue_scheduler.h"
+#include "emotional_manager/vision_features.h"
+
+using namespace dlib;
+using namespace std;
+using namespace emotional_manager;
+
+static const int frameSizes[][2] = {{320, 180}, {640, 360}, {1280, 720}};
+
+// Builds 68 landmarks for a face of the given size. The offset moves the nose
+// and the mouth so that each synthetic face looks at a different direction.
+static full_object_detection syntheticFace(long x, long y, long size, float offset){
+    std::vector<point> parts(68, point(x + size/2, y + size/2));
+    parts[2] = point(x, y + size/2);                                      // right_side
+    parts[14] = point(x + size, y + size/2);                              // left_side
+    parts[21] = point(x + size*4/10, y + size/4);                         // eyebrow_right
+    parts[22] = point(x + size*6/10, y + size/4);                         // eyebrow_left
+    parts[30] = point(x + size/2 + long(offset*size), y + size*6/10);     // nose
+    parts[48] = point(x + size*3/10, y + size*8/10);                      // mouth_right
+    parts[54] = point(x + size*7/10, y + size*8/10);                      // mouth_left
+    parts[51] = point(x + size/2, y + size*7/10 + long(offset*size));     // mouth_up
+    parts[57] = point(x + size/2, y + size*9/10);                         // mouth_down
+    return full_object_detection(rectangle(x, y, x + size, y + size), parts);
+}
+
+static std::vector<full_object_detection> syntheticFaces(int n){
+    std::vector<full_object_detection> faces;
+    for (int i = 0; i < n; ++i){
+        float offset = 0.1f*((i % 5) - 2);
+        faces.push_back(syntheticFace(20 + 90*(i % 7), 20 + 90*(i / 7), 80, offset));
+    }
+    return faces;
+}
+
+// Gray frame with some texture so that there are corners to track.
+static cv::Mat syntheticFrame(int width, int height, int shift){
+    cv::Mat frame(height, width, CV_8UC3, cv::Scalar(40, 40, 40));
+    cv::RNG rng(12345);
+    for (int i = 0; i < 200; ++i){
+        cv::Point center(rng.uniform(0, width) + shift, rng.uniform(0, height));
+        cv::circle(frame, center, rng.uniform(3, 15), cv::Scalar::all(rng.uniform(80, 255)), -1);
+    }
+    return frame;
+}
+
+static void BM_GetPointFromPart(benchmark::State& state){
+    full_object_detection shape = syntheticFace(100, 100, 120, 0.0f);
+    while (state.KeepRunning()){
+        benchmark::DoNotOptimize(getPointFromPart(shape, "nose"));
+    }
+}
+BENCHMARK(BM_GetPointFromPart);
+
+static void BM_LineIntersection(benchmark::State& state){
+    float p[8] = {0, 0, 10, 10, 0, 10, 10, 0};
+    while (state.KeepRunning()){
+        benchmark::DoNotOptimize(get_line_intersection(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]));
+    }
+}
+BENCHMARK(BM_LineIntersection);
+
+static void BM_LookAt(benchmark::State& state){
+    full_object_detection shape = syntheticFace(100, 100, 120, 0.2f);
+    while (state.KeepRunning()){
+        Gaze gaze = lookAt(shape);
+        benchmark::DoNotOptimize(gaze);
+    }
+}
+BENCHMARK(BM_LookAt);
+
+static void BM_SizeHead(benchmark::State& state){
+    full_object_detection shape = syntheticFace(100, 100, 120, 0.0f);
+    CueState cues;
+    int size;
+    while (state.KeepRunning()){
+        benchmark::DoNotOptimize(sizeHead(shape, cues, size));
+    }
+}
+BENCHMARK(BM_SizeHead);
+
+static void BM_SmileDetector(benchmark::State& state){
+    full_object_detection shape = syntheticFace(100, 100, 120, 0.2f);
+    while (state.KeepRunning()){
+        benchmark::DoNotOptimize(smileDetector(shape));
+    }
+}
+BENCHMARK(BM_SmileDetector);
+
+static void BM_Novelty(benchmark::State& state){
+    std::vector<bool> lookTowards(4, false);
+    CueState cues;
+    float value;
+    unsigned long frame = 0;
+    while (state.KeepRunning()){
+        lookTowards[frame % 4] = !lookTowards[frame % 4];
+        benchmark::DoNotOptimize(novelty(lookTowards, 1 + frame % 3, 0.1, 0.00000001, 1, cues, value));
+        frame++;
+    }
+}
+BENCHMARK(BM_Novelty);
+
+// All the cues of a frame with N faces, as done by the main loop.
+static void BM_FaceCues(benchmark::State& state){
+    std::vector<full_object_detection> faces = syntheticFaces(state.range(0));
+    CueState cues;
+    CueScheduler scheduler;
+    ContactHistory contacts;
+    std::vector<CueEvent> batch;
+    double stamp = 0;
+    while (state.KeepRunning()){
+        for (unsigned int i = 0; i < faces.size(); ++i){
+            Gaze gaze = lookAt(faces[i]);
+            for (unsigned int j = 0; j < gaze.lookAt.size(); ++j){
+                scheduler.observe("lookAt", lookAtEvents[j], i, gaze.lookAt[j], stamp);
+            }
+            contacts.record(stamp, i, gaze.direction, gaze.nose.x, gaze.nose.y);
+            int size;
+            float value;
+            if (sizeHead(faces[i], cues, size)){
+                scheduler.push("sizeHead", "", i, size, stamp);
+            }
+            scheduler.observe("smile", "", i, smileDetector(faces[i]), stamp);
+            benchmark::DoNotOptimize(novelty(gaze.lookAt, faces.size(), 0.1, 0.00000001, 1, cues, value));
+        }
+        scheduler.flush(stamp, batch);
+        stamp += 0.05;
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_FaceCues)->RangeMultiplier(2)->Range(1, 32);
+
+// Hysteresis and batching of the cues of 8 faces at the given frame rate.
+static void BM_CueScheduler(benchmark::State& state){
+    CueScheduler scheduler;
+    std::vector<CueEvent> batch;
+    const double period = 1.0/state.range(0);
+    double stamp = 0;
+    unsigned long frame = 0, batches = 0;
+    while (state.KeepRunning()){
+        for (int face = 0; face < 8; ++face){
+            scheduler.observe("lookAt", "right", face, (frame / 10 + face) % 2 == 0, stamp);
+            scheduler.observe("smile", "", face, (frame / 25 + face) % 3 == 0, stamp);
+        }
+        scheduler.push("movement", "", -1, frame, stamp);
+        batches += scheduler.flush(stamp, batch);
+        stamp += period;
+        frame++;
+    }
+    state.counters["batches_per_s"] = batches/stamp;
+}
+BENCHMARK(BM_CueScheduler)->Arg(10)->Arg(30)->Arg(120);
+
+static void BM_AmountMovement(benchmark::State& state){
+    const int width = frameSizes[state.range(0)][0];
+    const int height = frameSizes[state.range(0)][1];
+    cv::Mat frames[2] = {syntheticFrame(width, height, 0), syntheticFrame(width, height, 3)};
+    cv::Mat grayFrames[2];
+    cv::cvtColor(frames[0], grayFrames[0], CV_BGR2GRAY);
+    cv::cvtColor(frames[1], grayFrames[1], CV_BGR2GRAY);
+
+    cv::Mat rgbFrames, prevGrayFrame;
+    cv::Mat opticalFlow = cv::Mat(height, height, CV_32FC3);
+    std::vector<cv::Point2f> points1, points2;
+    bool needToInit = true;
+    float movement;
+    int k = 0;
+    while (state.KeepRunning()){
+        frames[k].copyTo(rgbFrames);
+        amountMovement(rgbFrames, grayFrames[k], prevGrayFrame, opticalFlow, points1, points2, needToInit, 3.0f, movement);
+        std::swap(points2, points1);
+        points1.clear();
+        grayFrames[k].copyTo(prevGrayFrame);
+        k = 1 - k;
+    }
+    state.SetLabel(to_string(width) + "x" + to_string(height));
+}
+BENCHMARK(BM_AmountMovement)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+static void BM_FaceDetector(benchmark::State& state){
+    const int width = frameSizes[state.range(0)][0];
+    const int height = frameSizes[state.range(0)][1];
+    cv::Mat frame = syntheticFrame(width, height, 0);
+    cv_image<bgr_pixel> cimg(frame);
+    frontal_face_detector detector = get_frontal_face_detector();
+    while (state.KeepRunning()){
+        std::vector<rectangle> faces = detector(cimg);
+        benchmark::DoNotOptimize(faces);
+    }
+    state.SetLabel(to_string(width) + "x" + to_string(height));
+}
+BENCHMARK(BM_FaceDetector)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Detection, landmarks and cues on a recorded frame.
+static void BM_RecordedFrame(benchmark::State& state, cv::Mat frame, shape_predictor *pose_model){
+    cv_image<bgr_pixel> cimg(frame);
+    frontal_face_detector detector = get_frontal_face_detector();
+    CueState cues;
+    while (state.KeepRunning()){
+        std::vector<rectangle> faces = detector(cimg);
+        for (unsigned long i = 0; i < faces.size(); ++i){
+            full_object_detection shape = (*pose_model)(cimg, faces[i]);
+            Gaze gaze = lookAt(shape);
+            int size;
+            benchmark::DoNotOptimize(sizeHead(shape, cues, size));
+            benchmark::DoNotOptimize(smileDetector(shape));
+            benchmark::DoNotOptimize(gaze);
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    benchmark::Initialize(&argc, argv);
+
+    shape_predictor pose_model;
+    const char *image = getenv("VISION_BENCH_IMAGE");
+    const char *model = getenv("VISION_BENCH_MODEL");
+    if (image && model){
+        deserialize(model) >> pose_model;
+        cv::Mat frame = cv::imread(image);
+        if (!frame.empty()){
+            benchmark::RegisterBenchmark("BM_RecordedFrame", BM_RecordedFrame, frame, &pose_model)
+                ->Unit(benchmark::kMillisecond);
+        }
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+    Expresses an emotion (a point in the valence-arousal map) on the robot:
+    eye colour, speech pitch and volume, head and arms posture. It is the
+    native version of the current_emotion_callback of action_manager.py.
+
+    Emotions are handed to a worker thread. Updates arriving while the
+    worker is busy, or within the coalescing window, are merged so that only
+    the latest one is expressed, and a new motion stops the running one
+    instead of waiting for it to finish.
+*/
+
+#ifndef EMOTIONAL_MANAGER_BEHAVIOR_ENGINE_H
+#define EMOTIONAL_MANAGER_BEHAVIOR_ENGINE_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "emotional_manager/robot_interface.h"
+
+namespace emotional_manager {
+
+// Valence and arousal are normalised between -1 and 1.
+struct Emotion {
+    float valence;
+    float arousal;
+    std::string name;
+};
+
+struct SpeechParameters {
+    float pitch;    // Pitch shift, 1.0 - 4.0
+    float volume;   // Gain, 0.0 - 1.0
+};
+
+// Bilinear interpolation of the lookup tables between the 11x11 cells.
+uint32_t eyeColour(float valence, float arousal);
+SpeechParameters speechParameters(float valence, float arousal);
+
+// Head pitch inversely proportional to arousal, stance proportional to valence.
+MotionCommand motionKeyframes(float valence, float arousal);
+
+class BehaviorEngine {
+public:
+    // Updates closer than coalesce_window seconds are merged into the latest one.
+    BehaviorEngine(RobotInterface &robot, double coalesce_window = 0.05);
+    ~BehaviorEngine();
+
+    // Returns immediately, the emotion is expressed by the worker thread.
+    void setEmotion(const Emotion &emotion, bool move = true);
+
+    unsigned long received() const;
+    unsigned long expressed() const;
+
+private:
+    void run();
+    void express(const Emotion &emotion, bool move);
+
+    RobotInterface &robot_;
+    double coalesce_window_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable pending_cv_;
+    bool pending_;
+    bool stop_;
+    Emotion emotion_;
+    bool move_;
+    unsigned long received_;
+    unsigned long expressed_;
+
+    int motion_;
+    std::thread worker_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_BEHAVIOR_ENGINE_H
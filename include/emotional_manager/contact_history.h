@@ -0,0 +1,141 @@
+/*
+    Bounded gaze/contact history of a session. Every face observation is
+    stored as a small record in a fixed-capacity ring buffer, so memory does
+    not grow with the length of the interaction, and running aggregates are
+    kept aside so they cover the whole session even after old records have
+    been overwritten. The aggregates are kept per face, a contact period
+    ends when the face looks away, when no face is seen or when the face
+    has not been observed for longer than max_gap seconds.
+*/
+
+#ifndef EMOTIONAL_MANAGER_CONTACT_HISTORY_H
+#define EMOTIONAL_MANAGER_CONTACT_HISTORY_H
+
+#include <cstddef>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace emotional_manager {
+
+// Where the child is looking at. GAZE_CONTACT means facing the robot.
+enum GazeDirection {
+    GAZE_CONTACT = 0,
+    GAZE_RIGHT,
+    GAZE_LEFT,
+    GAZE_UP,
+    GAZE_DOWN,
+    GAZE_COUNT
+};
+
+const char* gazeDirectionName(GazeDirection direction);
+
+// Compact record of one face observation (16 bytes instead of 68 landmarks).
+struct GazeRecord {
+    double stamp;       // Seconds
+    int16_t nose_x;
+    int16_t nose_y;
+    int16_t face;       // Identifier given by the FaceTracker
+    uint8_t direction;  // GazeDirection
+};
+
+// Fixed-capacity circular buffer. Once full, the oldest element is overwritten.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity) : data_(capacity > 0 ? capacity : 1), head_(0), size_(0) {}
+
+    void push(const T &value){
+        data_[head_] = value;
+        head_ = (head_ + 1) % data_.size();
+        if (size_ < data_.size()){
+            size_++;
+        }
+    }
+
+    // Index 0 is the oldest element still stored.
+    const T& operator[](std::size_t i) const{
+        return data_[(head_ + data_.size() - size_ + i) % data_.size()];
+    }
+
+    const T& back() const{
+        return (*this)[size_ - 1];
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return data_.size(); }
+    bool empty() const { return size_ == 0; }
+
+    void clear(){
+        head_ = 0;
+        size_ = 0;
+    }
+
+private:
+    std::vector<T> data_;
+    std::size_t head_;
+    std::size_t size_;
+};
+
+// Aggregates over the whole session, independent of the ring buffer capacity.
+struct ContactStats {
+    ContactStats();
+
+    unsigned long observations;
+    unsigned long contact_observations;
+    unsigned long direction_counts[GAZE_COUNT];
+    unsigned long contact_episodes;     // Closed contact periods
+    double contact_time;                // Seconds summed over closed contact periods
+
+    double contactRatio() const;
+    double meanContactDuration() const;
+};
+
+class ContactHistory {
+public:
+    explicit ContactHistory(std::size_t capacity = 4096, double max_gap = 1.0);
+
+    // Adds an observation of a face. Stamps are expected to be non decreasing.
+    void record(double stamp, int face, GazeDirection direction, float nose_x, float nose_y);
+
+    // Closes the open contact periods, e.g. when a frame has no faces.
+    void lost(double stamp);
+
+    // Forgets the records and the aggregates, e.g. when a new child arrives.
+    void reset();
+
+    const RingBuffer<GazeRecord>& records() const { return records_; }
+
+    // Aggregates of all the faces and of a single one, the contact periods
+    // still open are counted as if they ended at the last observation.
+    ContactStats stats() const;
+    ContactStats stats(int face) const;
+
+    // Identifiers of the faces whose aggregates are kept apart.
+    std::vector<int> faces() const;
+
+    // One line summary, e.g. to be published at the end of a session.
+    std::string summary() const;
+
+private:
+    struct FaceContact {
+        ContactStats stats;
+        bool in_contact;
+        double contact_start;
+        double last_stamp;
+    };
+
+    void closeContactEpisode(FaceContact &face, double end);
+    static void addOpenEpisode(const FaceContact &face, ContactStats &stats);
+    static ContactStats withOpenEpisode(const FaceContact &face);
+
+    RingBuffer<GazeRecord> records_;
+    double max_gap_;
+    ContactStats stats_;                // Closed periods of all the faces
+    std::map<int, FaceContact> faces_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_CONTACT_HISTORY_H
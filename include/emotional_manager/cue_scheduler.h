@@ -0,0 +1,74 @@
+/*
+    Decouples the publishing of the visual cues from the frame rate.
+
+    Conditions which have to last (looking away, smiling) are debounced in
+    time per cue and per face: a condition fires once it has been active for
+    hold seconds, and gaps shorter than release seconds do not interrupt it.
+    A gap is also the time between two observations, so release has to be
+    longer than the period of the frames, setRelease() follows that period
+    when it changes.
+    Events are then gathered during a window and handed out as one batch,
+    where repeated events of the same cue and face are merged, with at most
+    max_rate batches per second.
+*/
+
+#ifndef EMOTIONAL_MANAGER_CUE_SCHEDULER_H
+#define EMOTIONAL_MANAGER_CUE_SCHEDULER_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace emotional_manager {
+
+struct CueEvent {
+    std::string cue;    // lookAt, smile, movement, sizeHead, novelty
+    std::string data;   // e.g. the gaze direction for lookAt
+    float value;
+    int face;           // -1 when the cue is not related to a face
+    unsigned int count; // Number of merged events
+    double stamp;       // Seconds, of the latest merged event
+};
+
+class CueScheduler {
+public:
+    CueScheduler(double hold = 0.3, double release = 0.5, double window = 0.2, double max_rate = 5.0);
+
+    // Reports the state of a condition at time stamp. Returns true, and queues
+    // the event, when it has been active for hold seconds. It then has to
+    // last another hold seconds to fire again.
+    bool observe(const std::string &cue, const std::string &data, int face, bool active, double stamp);
+
+    // Changes the release of all the conditions, e.g. when the frame rate changes.
+    void setRelease(double release);
+
+    // Queues an event which does not need debouncing.
+    void push(const std::string &cue, const std::string &data, int face, float value, double stamp);
+
+    // Moves the pending events to batch when the window and the rate allow it.
+    bool flush(double stamp, std::vector<CueEvent> &batch);
+
+private:
+    typedef std::pair<std::string, int> Key;
+
+    struct Hysteresis {
+        double onset;       // Start of the current active period, -1 if inactive
+        double last_active;
+        double last_seen;
+    };
+
+    double hold_;
+    double release_;
+    double window_;
+    double min_interval_;
+
+    std::map<Key, Hysteresis> conditions_;
+    std::vector<CueEvent> pending_;
+    double first_pending_;
+    double last_flush_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_CUE_SCHEDULER_H
@@ -0,0 +1,72 @@
+/*
+    Engagement from the response time of the child (see nodes/IRT.py):
+
+        P(correct|rt,L) = u/(1+exp(-a(-rt+b*L)))
+        P(engaged) = P(correct)/u
+
+    Instead of fitting a and b once with the data of all the children, the
+    parameters are refined with every answer of the child by a recursive
+    Gauss-Newton step (recursive least squares on the linearised model with
+    a forgetting factor), so each update costs the same whatever the number
+    of samples already seen.
+*/
+
+#ifndef EMOTIONAL_MANAGER_ENGAGEMENT_MODEL_H
+#define EMOTIONAL_MANAGER_ENGAGEMENT_MODEL_H
+
+#include <map>
+#include <string>
+
+namespace emotional_manager {
+
+class EngagementModel {
+public:
+    // Default a and b are the fit of nodes/Hard.csv.
+    explicit EngagementModel(double a = -0.744, double b = 0.460, double u = 0.8, double L = 4.5,
+                             double forgetting = 0.95);
+
+    double probabilityCorrect(double rt) const;
+    double engagement(double rt) const;
+
+    // Adds the observed performance of an answer given in rt seconds.
+    void update(double rt, double p_correct);
+
+    double a() const { return a_; }
+    double b() const { return b_; }
+    double upperBound() const { return u_; }
+    unsigned long samples() const { return samples_; }
+
+private:
+    double a_;
+    double b_;
+    double u_;      // Upper bound
+    double L_;      // Mean number of characters in word
+    double lambda_; // Forgetting factor, 1 keeps all the samples
+    double P_[2][2];  // Covariance of (a, b)
+    unsigned long samples_;
+};
+
+// Fits the model with the rows "rt,P" of a csv file. Returns false if it cannot be read.
+bool fitFromCsv(const std::string &path, EngagementModel &model, int passes = 20);
+
+// One model per child, each one starting from the population model.
+class EngagementEstimator {
+public:
+    explicit EngagementEstimator(const EngagementModel &prior = EngagementModel());
+
+    // Selects the child the next samples belong to.
+    void setChild(const std::string &name);
+    const std::string& child() const { return child_; }
+
+    EngagementModel& model();
+
+private:
+    EngagementModel prior_;
+    std::map<std::string, EngagementModel> children_;
+    std::string child_;
+    EngagementModel *current_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_ENGAGEMENT_MODEL_H
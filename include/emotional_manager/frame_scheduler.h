@@ -0,0 +1,53 @@
+/*
+    Shares a CPU budget between several camera sources. Each source reports
+    how long its frames take to be processed and gets back the period to wait
+    between two frames. While the budget allows it every source runs at its
+    maximum rate, otherwise the budget is split according to the weights
+    (water-filling, so what a source does not need goes to the others).
+*/
+
+#ifndef EMOTIONAL_MANAGER_FRAME_SCHEDULER_H
+#define EMOTIONAL_MANAGER_FRAME_SCHEDULER_H
+
+#include <mutex>
+#include <vector>
+
+namespace emotional_manager {
+
+class FrameScheduler {
+public:
+    // Budget in cores, e.g. 1.5 allows to use one core and a half.
+    explicit FrameScheduler(double cpu_budget);
+
+    // Returns the identifier of the new source.
+    int addSource(double max_rate, double weight = 1.0);
+
+    // The source does not take part in the budget anymore.
+    void removeSource(int source);
+
+    // Processing time of the last frame of the source, in seconds.
+    void frameProcessed(int source, double duration);
+
+    // Frames per second allowed to the source and its inverse.
+    double rate(int source) const;
+    double period(int source) const;
+
+private:
+    struct Source {
+        double max_rate;
+        double weight;
+        double cost;    // EMA of the processing time of a frame
+        double rate;
+        bool removed;
+    };
+
+    void rebalance();
+
+    std::vector<Source> sources_;
+    double cpu_budget_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_FRAME_SCHEDULER_H
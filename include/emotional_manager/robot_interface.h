@@ -0,0 +1,78 @@
+/*
+    What the behavior engine needs from the robot: eye LEDs, speech
+    parameters and joint motions. The motions are posted and run in the
+    background so that a new emotion can stop them before they finish.
+    MockRobot stands in for NAOqi to run the engine without a robot.
+*/
+
+#ifndef EMOTIONAL_MANAGER_ROBOT_INTERFACE_H
+#define EMOTIONAL_MANAGER_ROBOT_INTERFACE_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace emotional_manager {
+
+// Joint keyframes in the format of ALMotion::angleInterpolation.
+struct MotionCommand {
+    std::vector<std::string> names;
+    std::vector<std::vector<float> > times;
+    std::vector<std::vector<float> > keys;
+    bool absolute;
+};
+
+class RobotInterface {
+public:
+    virtual ~RobotInterface() {}
+
+    virtual void fadeRGB(const std::string &group, uint32_t rgb, float duration) = 0;
+    virtual void setSpeechParameters(float pitch, float volume) = 0;
+
+    // Starts the motion without waiting for it and returns its identifier.
+    virtual int postMotion(const MotionCommand &motion) = 0;
+    virtual bool isRunning(int motion) = 0;
+    virtual void stopMotion(int motion) = 0;
+};
+
+// Records the commands instead of sending them to a robot.
+class MockRobot : public RobotInterface {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    MockRobot();
+
+    void fadeRGB(const std::string &group, uint32_t rgb, float duration);
+    void setSpeechParameters(float pitch, float volume);
+    int postMotion(const MotionCommand &motion);
+    bool isRunning(int motion);
+    void stopMotion(int motion);
+
+    unsigned long commands() const;
+    unsigned long preempted() const;
+    uint32_t lastColour() const;
+    Clock::time_point lastCommandTime() const;
+
+    // Blocks until at least n commands have been received.
+    void waitForCommands(unsigned long n);
+
+private:
+    void commandReceived();
+
+    mutable std::mutex mutex_;
+    std::condition_variable received_;
+    unsigned long commands_;
+    unsigned long preempted_;
+    uint32_t last_colour_;
+    Clock::time_point last_command_;
+    int motion_id_;
+    Clock::time_point motion_end_;
+};
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_ROBOT_INTERFACE_H
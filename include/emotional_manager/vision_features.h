@@ -0,0 +1,103 @@
+/*
+    Visual cues extracted by the vision node: gaze direction, head size,
+    smile, novelty and amount of movement. The functions only compute the
+    cues from the landmarks of a face (or from the frames for the optical
+    flow) and update a CueState, publishing is left to the caller. This way
+    they can be exercised in isolation, e.g. by the benchmarks.
+*/
+
+#ifndef EMOTIONAL_MANAGER_VISION_FEATURES_H
+#define EMOTIONAL_MANAGER_VISION_FEATURES_H
+
+#include <dlib/image_processing/full_object_detection.h>
+#include <opencv2/core/core.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "emotional_manager/contact_history.h"
+
+namespace emotional_manager {
+
+// Filters which are kept from one frame to the next. The debouncing of the
+// cues is done in time by the CueScheduler.
+struct CueState {
+    CueState();
+
+    bool contact;
+    float t;
+    std::vector<float> EMA;
+    int prevSize;
+};
+
+// Result of the gaze estimation of one face.
+struct Gaze {
+    std::vector<bool> lookAt;           // right, left, up, down
+    GazeDirection direction;            // Raw direction of this frame
+    cv::Point2f nose;
+};
+
+// Names of the lookAt events, indexed like Gaze::lookAt.
+extern const char* const lookAtEvents[4];
+
+// Keeps an identifier per face while it stays close to its previous position.
+// A face which is not detected keeps its identifier for retention seconds, so
+// a missed detection does not make it a new face. Identifiers are reused
+// after MAX_FACE_ID to fit in GazeRecord::face.
+class FaceTracker {
+public:
+    FaceTracker(double retention = 0.5);
+    void setRetention(double retention);
+    std::vector<int> update(const std::vector<dlib::rectangle> &faces, double stamp);
+
+private:
+    struct Track {
+        int id;
+        dlib::rectangle face;
+        double last_seen;
+    };
+
+    int nextId();
+
+    std::vector<Track> tracks_;
+    double retention_;
+    int next_id_;
+};
+
+// Return the point correspondent to the dictionary marker.
+cv::Point2f getPointFromPart(const dlib::full_object_detection &shape, const std::string &name);
+
+// Returns 1 if the lines intersect, otherwise 0.
+bool get_line_intersection(float p0_x, float p0_y, float p1_x, float p1_y,
+                           float p2_x, float p2_y, float p3_x, float p3_y);
+
+// Computes the size of the head. Returns true if it changed enough to be published.
+bool sizeHead(const dlib::full_object_detection &shape, CueState &state, int &size);
+
+// Returns true if the mouth of the face is smiling.
+bool smileDetector(const dlib::full_object_detection &shape);
+
+// Updates the EMA with the features X[]. Returns true if a novelty has been detected.
+bool updateNovelty(const std::vector<float> &X, float mu, float eps, float threshold,
+                   CueState &state, float &value);
+
+// Novelty of the current frame given the gaze of a face and the number of faces.
+bool novelty(const std::vector<bool> &lookAt, std::size_t nbFaces, float mu, float eps, float threshold,
+             CueState &state, float &value);
+
+// Estimates where the face is looking at.
+Gaze lookAt(const dlib::full_object_detection &shape);
+
+// Amount of movement using optical flow, as the mean displacement in pixels of the
+// tracked corners since the previous frame. Returns true if it is above threshold.
+bool amountMovement(cv::Mat &rgbFrames, cv::Mat &grayFrames, cv::Mat &prevGrayFrame,
+                    cv::Mat &opticalFlow, std::vector<cv::Point2f> &points1, std::vector<cv::Point2f> &points2,
+                    bool &needToInit, float threshold, float &movement);
+
+// Draws a circle per each dlib marker into the frame.
+void shapeToPoints(cv::Mat &imgResult, const dlib::full_object_detection &shape);
+
+} // namespace emotional_manager
+
+#endif // EMOTIONAL_MANAGER_VISION_FEATURES_H
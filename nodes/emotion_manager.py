@@ -7,15 +7,15 @@ Created on Tue Mar 10 17:37:34 2015
 """
 
 import sys
+import threading
 import rospy
 import numpy as np
 from std_msgs.msg import Int16, Int32, String, Empty, Float32
 from geometry_msgs.msg import PointStamped, Point
+from emotional_manager.msg import CueBatch
 
 from naoqi import ALBroker
 
-from IRT import engagement_model
-
 NAO_IP = "192.168.1.12"
 
 class emotion_manager():
@@ -52,20 +52,32 @@ class emotion_manager():
         self.pub_direction = rospy.Publisher('update_position', PointStamped, queue_size=10)
         self.nb_features = 9
         
-        # Cues to evaluate:
-        rospy.Subscriber("lookAt", String, self.look_robot_callback)            # Where the child is looking at
-        rospy.Subscriber("smile", Empty, self.smile_robot_callback)             # The child is smiling
-        rospy.Subscriber("movement", Int16, self.movement_callback)             # The child is moving while sitting
-        rospy.Subscriber("sizeHead", Int16, self.proximity_callback)            # The child is getting closer
-        rospy.Subscriber("novelty", Float32, self.novelty_callback)             # Something new happen in the scenario
+        # Visual cues, batched by the vision node. With several cameras the vision node
+        # publishes the cues of each one on its own namespace, all of them feed the same features.
+        #   lookAt:   Where the child is looking at
+        #   smile:    The child is smiling
+        #   movement: The child is moving while sitting
+        #   sizeHead: The child is getting closer
+        #   novelty:  Something new happen in the scenario
+        cameras = rospy.get_param('~cameras', [''])
+        for camera in cameras:
+            ns = camera + '/' if camera else ''
+            rospy.Subscriber(ns + "cues", CueBatch, self.cues_callback)
+
+        # Several cameras may see the same event. Their batches are fused every fusion_window
+        # seconds keeping for each cue the camera which saw it the most times.
+        self.fuse_cameras = len(cameras) > 1
+        self.camera_cues = {}
+        self.cues_lock = threading.Lock()
+        if self.fuse_cameras:
+            rospy.Timer(rospy.Duration(rospy.get_param('~fusion_window', 0.2)), self.fusion_callback)
         rospy.Subscriber("activity_time", Int32, self.time_callback)            # For how long the activity was done
         rospy.Subscriber("nb_repetitions", Int16, self.repetitions_callback)    # The number of word repetitions
         rospy.Subscriber("time_response", Float32, self.response_callback)      # Response time till the child writes
-        rospy.Subscriber("time_writing", Float32, self.writing_callback)        # Writing time during demostration
+        rospy.Subscriber("level_engagement", Point, self.engagement_callback)   # Engagement estimated by the engagement node
                 
         rospy.Subscriber('stop_learning', Empty, self.stop_request_callback)    #listen for when to stop
         
-        self.pub_engagement = rospy.Publisher('level_engagement', Point, queue_size=10)
         self.pub_activity = rospy.Publisher('activity', String, queue_size=10)  #Publishes the current activity which is performed
 
         # Boundaries of the map
@@ -158,7 +170,51 @@ class emotion_manager():
     
     #----------------------------------------------CALLLBACKS----------------------------------------------
     
-    def look_robot_callback(self, data):
+    def cues_callback(self, data):
+        if not self.fuse_cameras:
+            self.apply_cues([(cue.cue, cue.data, cue.value, cue.count) for cue in data.cues])
+            return
+
+        # Events of all the faces add up within a camera, header.frame_id is the camera
+        with self.cues_lock:
+            cues = self.camera_cues.setdefault(data.header.frame_id, {})
+            for cue in data.cues:
+                count, value = cues.get((cue.cue, cue.data), (0, cue.value))
+                cues[(cue.cue, cue.data)] = (count + cue.count, cue.value)
+
+    def fusion_callback(self, event):
+        with self.cues_lock:
+            camera_cues = self.camera_cues
+            self.camera_cues = {}
+
+        # The same event seen by several cameras counts once
+        fused = {}
+        for cues in camera_cues.itervalues():
+            for key, (count, value) in cues.iteritems():
+                if key not in fused or count > fused[key][0]:
+                    fused[key] = (count, value)
+        if fused:
+            self.apply_cues([(cue, data, value, count) for (cue, data), (count, value) in fused.iteritems()])
+
+    def apply_cues(self, cues):
+        # The vision node merges repeated events, each one still moves the features
+        # as if it had arrived alone but the position is published once per batch
+        for cue, data, value, count in cues:
+            for i in range(count):
+                if cue == "lookAt":
+                    self.look_robot_callback(String(data), False)
+                elif cue == "smile":
+                    self.smile_robot_callback(Empty(), False)
+                elif cue == "movement":
+                    self.movement_callback(Float32(value), False)
+                elif cue == "sizeHead":
+                    self.proximity_callback(Int16(int(value)), False)
+                elif cue == "novelty":
+                    self.novelty_callback(Float32(value), False)
+        msg = self.buildMessage()
+        self.pub_direction.publish(msg)
+    
+    def look_robot_callback(self, data, publish=True):
         rospy.loginfo(rospy.get_caller_id() + " The children is looking: %s", data.data)
         #If the child does not give attention to the robot we assume is bored
         looking = data.data
@@ -185,8 +241,9 @@ class emotion_manager():
             
         # Weight the features depending on its importance
         self.weighting()
-        msg = self.buildMessage()
-        self.pub_direction.publish(msg)
+        if publish:
+            msg = self.buildMessage()
+            self.pub_direction.publish(msg)
         
     
     def time_callback(self, data):
@@ -236,7 +293,7 @@ class emotion_manager():
         self.pub_direction.publish(msg)
 
         
-    def smile_robot_callback(self, data):
+    def smile_robot_callback(self, data, publish=True):
         rospy.loginfo(rospy.get_caller_id() + "The children is smiling at the robot")
         #Calculate the new vector to move towards
         direction_x = self.emotional_dictionary['happiness']['x'] - self.current_position['x']
@@ -249,11 +306,12 @@ class emotion_manager():
         
         # Weight the features depending on its importance, pack and send
         self.weighting()
-        msg = self.buildMessage()
-        self.pub_direction.publish(msg)
+        if publish:
+            msg = self.buildMessage()
+            self.pub_direction.publish(msg)
         
         
-    def movement_callback(self, data):
+    def movement_callback(self, data, publish=True):
         #rospy.loginfo(rospy.get_caller_id() + "The children is moving: %s", data.data)
         #Calculate the new vector to move towards
         direction_x = self.emotional_dictionary['activation']['x'] - self.current_position['x']
@@ -266,11 +324,12 @@ class emotion_manager():
         
         # Weight the features depending on its importance, pack and send
         self.weighting()
-        msg = self.buildMessage()
-        self.pub_direction.publish(msg)
+        if publish:
+            msg = self.buildMessage()
+            self.pub_direction.publish(msg)
 
               
-    def proximity_callback(self, data):
+    def proximity_callback(self, data, publish=True):
         #Calculate the new vector to move towards
         if data.data > 90:
             #rospy.loginfo(rospy.get_caller_id() + "The children is close to the robot" + str(data.data))
@@ -284,11 +343,12 @@ class emotion_manager():
         
             # Weight the features depending on its importance, pack and send
             self.weighting()
-            msg = self.buildMessage()
-            self.pub_direction.publish(msg)
+            if publish:
+                msg = self.buildMessage()
+                self.pub_direction.publish(msg)
 
             
-    def novelty_callback(self, data):
+    def novelty_callback(self, data, publish=True):
         rospy.loginfo(rospy.get_caller_id() + "The robot saw a novelty!")
         #Calculate the new vector to move towards     
         direction_x = self.emotional_dictionary['surprise']['x'] - self.current_position['x']
@@ -302,8 +362,9 @@ class emotion_manager():
         
         # Weight the features depending on its importance, pack and send
         self.weighting()
-        msg = self.buildMessage()
-        self.pub_direction.publish(msg)        
+        if publish:
+            msg = self.buildMessage()
+            self.pub_direction.publish(msg)
         
         
     def response_callback(self, data):       
@@ -313,20 +374,10 @@ class emotion_manager():
         rospy.loginfo(rt_sec)
         
                           
-    # In order to test with a time response of 5 sec: rostopic pub -1 /responseTime std_msgs/Float32 '5'    
-    def writing_callback(self, data):
-        myModel = engagement_model()
-        myModel.train_model()
-        # TODO: Check why it does not show the plot
-        myModel.plot_data()
-        
-        # From ms. to s. and get Prob of being engaged  
-        wt_sec = data.data / 1000
-        P_results = myModel.get_engagement(wt_sec)
-        
-        # Rescale to have a positive and negative engagement where 0 is 50
-        engagement_level = int(P_results[0]*100)
-        engagement_level = (engagement_level * 2) - 100
+    # The engagement node computes the level from the response time with the model of the current child.
+    # In order to test with a response time of 5 sec: rostopic pub -1 /time_response std_msgs/Float32 '5000'
+    def engagement_callback(self, data):
+        engagement_level = int(data.x)
         
         #Store the result in the history
         self.engagement_history.append(engagement_level)
@@ -334,11 +385,6 @@ class emotion_manager():
         
         rospy.loginfo(engagement_level)
         
-        # Publish to the map
-        point = Point()
-        point.x = engagement_level    
-        self.pub_engagement.publish(point)
-        
     
     def stop_request_callback(self, data):
         rospy.signal_shutdown('Interaction exited')
@@ -0,0 +1,213 @@
+#include "emotional_manager/behavior_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace emotional_manager {
+
+// Lookup tables indexed by [arousal][valence]. Row 0 is the highest arousal
+// and column 0 the lowest valence, the center cell is the neutral emotion.
+static constexpr uint32_t eye_colour_lookup_table[11][11] = {
+    {0xF82C35, 0xF82C35, 0xD55528, 0xD55528, 0xFF622B, 0xFF622B, 0xFFB047, 0xFFB047, 0xFFB047, 0x56C427, 0x56C427},
+    {0xF82C35, 0xF82C35, 0xD5542A, 0xD5542A, 0xE96A37, 0xFF8232, 0xFF8232, 0xFEB340, 0xFEB340, 0x56C427, 0x56C427},
+    {0xF62D35, 0xF62D35, 0xF62D35, 0xE96A37, 0xE96A37, 0xFF984D, 0xFF8232, 0xFDC147, 0xFFB144, 0x56C427, 0x56C427},
+    {0xF72C32, 0xF72C32, 0xFF4048, 0xFE5761, 0xED8659, 0xFEB278, 0xFECE6A, 0xFECE6A, 0xFEE566, 0x56C427, 0x56C427},
+    {0xF6255C, 0xF6255C, 0xF9386F, 0xFD585E, 0xF78C84, 0xFFB379, 0xFEDEA1, 0xFEE67C, 0xFFE564, 0x56C427, 0x56C427},
+    {0xF6255C, 0xF93871, 0xF93871, 0xFE9EB9, 0xFE9EB9, 0xFFFFFF, 0xD0E7B3, 0xA5D277, 0x85B957, 0x6EAB34, 0x6EAB34},
+    {0xA82C72, 0xA82C72, 0xC03381, 0xDB5CA1, 0xE8A1C3, 0xD1E5F0, 0xCFDADE, 0x73B8B3, 0x87B958, 0x6EAB34, 0x6EAB34},
+    {0xA82C72, 0xA82C72, 0xC03381, 0x9C3F74, 0xB36893, 0xD1E4F2, 0x91C3E6, 0x91C3E6, 0x219A95, 0x00948E, 0x6BAC34},
+    {0xA82C72, 0xA82C72, 0x86305D, 0x86305D, 0x94C8D6, 0x93C8D8, 0x92C2E6, 0x3196CE, 0x009591, 0x009591, 0x009591},
+    {0xA62D72, 0x692850, 0x692850, 0x692850, 0x2D9DB1, 0x2C9FB2, 0x2F96CE, 0x0085BE, 0x00968D, 0x00968D, 0x00968D},
+    {0x692850, 0x692850, 0x692850, 0x692850, 0x037F9B, 0x037F9B, 0x0085BE, 0x0085BE, 0x0085BE, 0x0085BE, 0x0085BE}
+};
+
+// Format (pitch modifier, volume modifier)
+static constexpr float speech_parameter_lookup_table[11][11][2] = {
+    {{1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}},
+    {{1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}, {1.00f, 1.00f}},
+    {{1.00f, 0.75f}, {0.81f, 0.75f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {-0.25f, 0.00f}, {0.50f, 1.00f}, {0.62f, 0.50f}, {0.75f, 0.75f}, {0.75f, 0.75f}, {0.75f, 0.75f}, {1.00f, 0.75f}},
+    {{1.00f, 0.50f}, {0.63f, 0.50f}, {-0.20f, -0.50f}, {-1.00f, -1.00f}, {-0.25f, -0.50f}, {0.25f, 0.50f}, {0.25f, 0.50f}, {0.50f, 0.50f}, {0.50f, 0.50f}, {0.50f, 0.50f}, {0.00f, 0.50f}},
+    {{1.00f, 0.25f}, {0.44f, 0.25f}, {0.40f, -0.50f}, {0.30f, -0.50f}, {0.25f, -0.50f}, {0.25f, 0.00f}, {0.25f, 0.00f}, {0.25f, 0.25f}, {0.25f, 0.25f}, {0.25f, 0.25f}, {0.00f, 0.25f}},
+    {{1.00f, 0.00f}, {0.25f, 0.00f}, {0.10f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.10f, 0.00f}, {0.10f, 0.00f}, {0.10f, 0.00f}, {0.00f, 0.00f}},
+    {{0.25f, -0.25f}, {0.06f, -0.25f}, {-0.10f, -0.25f}, {-0.20f, 0.00f}, {-0.20f, 0.00f}, {-0.10f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}},
+    {{-0.25f, -0.50f}, {-0.13f, -0.50f}, {-0.35f, -0.50f}, {-0.20f, -0.25f}, {-0.10f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}},
+    {{-0.25f, -0.75f}, {-0.31f, -0.75f}, {-0.35f, -0.75f}, {-0.10f, -0.50f}, {-0.10f, -0.25f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}},
+    {{-0.50f, -1.00f}, {-0.50f, -1.00f}, {-0.40f, -1.00f}, {-0.20f, -0.75f}, {-0.10f, -0.50f}, {0.00f, -0.25f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}},
+    {{-0.50f, -1.00f}, {-0.50f, -1.00f}, {-0.50f, -1.00f}, {-0.25f, -0.75f}, {0.00f, -0.50f}, {0.00f, -0.25f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}, {0.00f, 0.00f}}
+};
+
+static const float eye_duration = 0.1f;
+// The pitch and volume modifiers are divided by this value, e.g. 4 gives a +/- 25% of the default value
+static const float speech_parameter_scaling_value = 4.0f;
+
+// Continuous position of an emotion in the tables, clamped to the borders.
+struct Cell {
+    int row, col;
+    float dr, dc;
+};
+
+static Cell tableCell(float valence, float arousal){
+    float col = std::min(10.0f, std::max(0.0f, valence*5 + 5));
+    float row = std::min(10.0f, std::max(0.0f, 5 - arousal*5));
+    Cell cell;
+    cell.row = std::min(9, int(row));
+    cell.col = std::min(9, int(col));
+    cell.dr = row - cell.row;
+    cell.dc = col - cell.col;
+    return cell;
+}
+
+static float bilinear(const Cell &c, float v00, float v01, float v10, float v11){
+    return (1 - c.dr)*((1 - c.dc)*v00 + c.dc*v01) + c.dr*((1 - c.dc)*v10 + c.dc*v11);
+}
+
+uint32_t eyeColour(float valence, float arousal){
+    Cell c = tableCell(valence, arousal);
+    uint32_t rgb = 0;
+    // Interpolate every channel on its own
+    for (int shift = 0; shift <= 16; shift += 8){
+        float channel = bilinear(c,
+                                 (eye_colour_lookup_table[c.row][c.col] >> shift) & 0xFF,
+                                 (eye_colour_lookup_table[c.row][c.col + 1] >> shift) & 0xFF,
+                                 (eye_colour_lookup_table[c.row + 1][c.col] >> shift) & 0xFF,
+                                 (eye_colour_lookup_table[c.row + 1][c.col + 1] >> shift) & 0xFF);
+        rgb |= uint32_t(std::lround(channel)) << shift;
+    }
+    return rgb;
+}
+
+SpeechParameters speechParameters(float valence, float arousal){
+    Cell c = tableCell(valence, arousal);
+    float modifier[2];
+    for (int i = 0; i < 2; ++i){
+        modifier[i] = bilinear(c,
+                               speech_parameter_lookup_table[c.row][c.col][i],
+                               speech_parameter_lookup_table[c.row][c.col + 1][i],
+                               speech_parameter_lookup_table[c.row + 1][c.col][i],
+                               speech_parameter_lookup_table[c.row + 1][c.col + 1][i]);
+    }
+
+    SpeechParameters speech;
+    // NAO can only increase pitch! So a pitch reduction is negated. Range 1.0 - 4.0.
+    speech.pitch = std::max(1.0f, 1 + modifier[0]/speech_parameter_scaling_value);
+    // NAO volume (gain) range 0.0 - 1.0.
+    speech.volume = 0.5f + modifier[1]/speech_parameter_scaling_value;
+    return speech;
+}
+
+static void addJoint(MotionCommand &motion, const char *name, float start, float key, float end){
+    static const float times[3] = {0.5f, 2.0f, 4.0f};
+    const float keys[3] = {start, key, end};
+    motion.names.push_back(name);
+    motion.times.push_back(std::vector<float>(times, times + 3));
+    motion.keys.push_back(std::vector<float>(keys, keys + 3));
+}
+
+MotionCommand motionKeyframes(float valence, float arousal){
+    MotionCommand motion;
+    motion.absolute = true;
+
+    // Head pitch has a range of approx +0.5 to -0.5 radians
+    float head_pitch = arousal / 2 * -1;
+    addJoint(motion, "HeadPitch", 0.0f, head_pitch, 0.0f);
+
+    // Shoulders have a pitch of +2 to -2 radians, central pitch value is 1.4 radians.
+    float shoulder_pitch = 1.4f - valence * 0.5f;
+    addJoint(motion, "LShoulderPitch", 1.45726f, shoulder_pitch, 1.45726f);
+    addJoint(motion, "RShoulderPitch", 1.4f, shoulder_pitch, 1.4f);
+
+    float shoulder_roll = valence * 0.8f;
+    addJoint(motion, "LShoulderRoll", 0.5f, -shoulder_roll, 0.3f);
+    addJoint(motion, "RShoulderRoll", -0.5f, shoulder_roll, -0.3f);
+
+    return motion;
+}
+
+BehaviorEngine::BehaviorEngine(RobotInterface &robot, double coalesce_window) :
+    robot_(robot),
+    coalesce_window_(coalesce_window),
+    pending_(false),
+    stop_(false),
+    move_(false),
+    received_(0),
+    expressed_(0),
+    motion_(0){
+    worker_ = std::thread(&BehaviorEngine::run, this);
+}
+
+BehaviorEngine::~BehaviorEngine(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    pending_cv_.notify_all();
+    worker_.join();
+}
+
+void BehaviorEngine::setEmotion(const Emotion &emotion, bool move){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A pending emotion which was not expressed yet is replaced
+        emotion_ = emotion;
+        move_ = move_ || move;
+        pending_ = true;
+        received_++;
+    }
+    pending_cv_.notify_one();
+}
+
+unsigned long BehaviorEngine::received() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return received_;
+}
+
+unsigned long BehaviorEngine::expressed() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return expressed_;
+}
+
+void BehaviorEngine::run(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true){
+        pending_cv_.wait(lock, [this]{ return pending_ || stop_; });
+        if (stop_){
+            break;
+        }
+
+        // Let a burst of updates settle, only the latest one is expressed
+        if (coalesce_window_ > 0){
+            pending_cv_.wait_for(lock, std::chrono::duration<double>(coalesce_window_), [this]{ return stop_; });
+            if (stop_){
+                break;
+            }
+        }
+
+        Emotion emotion = emotion_;
+        bool move = move_;
+        pending_ = false;
+        move_ = false;
+
+        lock.unlock();
+        express(emotion, move);
+        lock.lock();
+        expressed_++;
+    }
+}
+
+void BehaviorEngine::express(const Emotion &emotion, bool move){
+    robot_.fadeRGB("FaceLeds", eyeColour(emotion.valence, emotion.arousal), eye_duration);
+
+    SpeechParameters speech = speechParameters(emotion.valence, emotion.arousal);
+    robot_.setSpeechParameters(speech.pitch, speech.volume);
+
+    if (move){
+        // The new emotion preempts the motion of the previous one
+        if (motion_ != 0 && robot_.isRunning(motion_)){
+            robot_.stopMotion(motion_);
+        }
+        motion_ = robot_.postMotion(motionKeyframes(emotion.valence, emotion.arousal));
+    }
+}
+
+} // namespace emotional_manager
@@ -0,0 +1,180 @@
+#include "emotional_manager/contact_history.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace emotional_manager {
+
+const char* gazeDirectionName(GazeDirection direction){
+    switch (direction){
+    case GAZE_CONTACT: return "contact";
+    case GAZE_RIGHT:   return "right";
+    case GAZE_LEFT:    return "left";
+    case GAZE_UP:      return "up";
+    case GAZE_DOWN:    return "down";
+    default:           return "unknown";
+    }
+}
+
+// Faces whose aggregates are kept apart, the least recently seen one is
+// folded into the session totals when a new face exceeds this number.
+static const std::size_t MAX_FACES = 64;
+
+ContactStats::ContactStats(){
+    std::memset(this, 0, sizeof(*this));
+}
+
+double ContactStats::contactRatio() const{
+    if (observations == 0){
+        return 0.0;
+    }
+    return double(contact_observations)/observations;
+}
+
+double ContactStats::meanContactDuration() const{
+    if (contact_episodes == 0){
+        return 0.0;
+    }
+    return contact_time/contact_episodes;
+}
+
+ContactHistory::ContactHistory(std::size_t capacity, double max_gap) : records_(capacity), max_gap_(max_gap){
+    reset();
+}
+
+void ContactHistory::record(double stamp, int face, GazeDirection direction, float nose_x, float nose_y){
+    GazeRecord rec;
+    rec.stamp = stamp;
+    rec.nose_x = int16_t(nose_x);
+    rec.nose_y = int16_t(nose_y);
+    rec.face = int16_t(face);
+    rec.direction = uint8_t(direction);
+    records_.push(rec);
+
+    std::map<int, FaceContact>::iterator it = faces_.find(face);
+    if (it == faces_.end()){
+        if (faces_.size() >= MAX_FACES){
+            std::map<int, FaceContact>::iterator oldest = faces_.begin();
+            for (it = faces_.begin(); it != faces_.end(); ++it){
+                if (it->second.last_stamp < oldest->second.last_stamp){
+                    oldest = it;
+                }
+            }
+            if (oldest->second.in_contact){
+                closeContactEpisode(oldest->second, oldest->second.last_stamp);
+            }
+            faces_.erase(oldest);
+        }
+        FaceContact contact;
+        contact.in_contact = false;
+        contact.contact_start = stamp;
+        contact.last_stamp = stamp;
+        it = faces_.insert(std::make_pair(face, contact)).first;
+    }
+    FaceContact &contact = it->second;
+
+    // The face was not observed for a while, its contact ended when it was last seen
+    if (contact.in_contact && stamp - contact.last_stamp > max_gap_){
+        closeContactEpisode(contact, contact.last_stamp);
+    }
+
+    stats_.observations++;
+    stats_.direction_counts[direction]++;
+    contact.stats.observations++;
+    contact.stats.direction_counts[direction]++;
+
+    if (direction == GAZE_CONTACT){
+        stats_.contact_observations++;
+        contact.stats.contact_observations++;
+        if (!contact.in_contact){
+            contact.in_contact = true;
+            contact.contact_start = stamp;
+        }
+    }
+    else if (contact.in_contact){
+        closeContactEpisode(contact, stamp);
+    }
+    contact.last_stamp = stamp;
+}
+
+void ContactHistory::lost(double stamp){
+    for (std::map<int, FaceContact>::iterator it = faces_.begin(); it != faces_.end(); ++it){
+        FaceContact &contact = it->second;
+        if (contact.in_contact){
+            closeContactEpisode(contact, stamp - contact.last_stamp > max_gap_ ? contact.last_stamp : stamp);
+        }
+    }
+}
+
+void ContactHistory::closeContactEpisode(FaceContact &face, double end){
+    face.stats.contact_episodes++;
+    face.stats.contact_time += end - face.contact_start;
+    stats_.contact_episodes++;
+    stats_.contact_time += end - face.contact_start;
+    face.in_contact = false;
+}
+
+// Counts a contact period still open as if it ended at the last observation
+void ContactHistory::addOpenEpisode(const FaceContact &face, ContactStats &stats){
+    if (face.in_contact){
+        stats.contact_episodes++;
+        stats.contact_time += face.last_stamp - face.contact_start;
+    }
+}
+
+ContactStats ContactHistory::withOpenEpisode(const FaceContact &face){
+    ContactStats stats = face.stats;
+    addOpenEpisode(face, stats);
+    return stats;
+}
+
+void ContactHistory::reset(){
+    records_.clear();
+    stats_ = ContactStats();
+    faces_.clear();
+}
+
+ContactStats ContactHistory::stats() const{
+    ContactStats stats = stats_;
+    for (std::map<int, FaceContact>::const_iterator it = faces_.begin(); it != faces_.end(); ++it){
+        addOpenEpisode(it->second, stats);
+    }
+    return stats;
+}
+
+ContactStats ContactHistory::stats(int face) const{
+    std::map<int, FaceContact>::const_iterator it = faces_.find(face);
+    if (it == faces_.end()){
+        return ContactStats();
+    }
+    return withOpenEpisode(it->second);
+}
+
+std::vector<int> ContactHistory::faces() const{
+    std::vector<int> ids;
+    for (std::map<int, FaceContact>::const_iterator it = faces_.begin(); it != faces_.end(); ++it){
+        ids.push_back(it->first);
+    }
+    return ids;
+}
+
+static void printStats(std::stringstream &ss, const ContactStats &stats){
+    ss << "observations:" << stats.observations
+       << " contact_ratio:" << stats.contactRatio()
+       << " mean_contact:" << stats.meanContactDuration();
+    for (int i = 0; i < GAZE_COUNT; ++i){
+        ss << " " << gazeDirectionName(GazeDirection(i)) << ":" << stats.direction_counts[i];
+    }
+}
+
+std::string ContactHistory::summary() const{
+    std::stringstream ss;
+    printStats(ss, stats());
+    for (std::map<int, FaceContact>::const_iterator it = faces_.begin(); it != faces_.end(); ++it){
+        ss << " | face " << it->first << " ";
+        printStats(ss, withOpenEpisode(it->second));
+    }
+    return ss.str();
+}
+
+} // namespace emotional_manager
@@ -0,0 +1,98 @@
+#include "emotional_manager/cue_scheduler.h"
+
+namespace emotional_manager {
+
+// Conditions of a face which was not seen for this long are forgotten
+static const double FORGET_TIME = 5.0;
+
+CueScheduler::CueScheduler(double hold, double release, double window, double max_rate) :
+    hold_(hold),
+    release_(release),
+    window_(window),
+    min_interval_(max_rate > 0 ? 1.0/max_rate : 0.0),
+    first_pending_(0.0),
+    last_flush_(-1e9){
+}
+
+void CueScheduler::setRelease(double release){
+    release_ = release;
+}
+
+bool CueScheduler::observe(const std::string &cue, const std::string &data, int face, bool active, double stamp){
+    Key key(cue + "/" + data, face);
+    std::map<Key, Hysteresis>::iterator it = conditions_.find(key);
+    if (it == conditions_.end()){
+        Hysteresis h;
+        h.onset = -1;
+        h.last_active = stamp;
+        it = conditions_.insert(std::make_pair(key, h)).first;
+    }
+    Hysteresis &h = it->second;
+    h.last_seen = stamp;
+
+    if (!active){
+        if (h.onset >= 0 && stamp - h.last_active > release_){
+            h.onset = -1;
+        }
+        return false;
+    }
+
+    // Starts a new active period, also when the condition was not observed
+    // for longer than release, e.g. the face was not detected meanwhile
+    if (h.onset < 0 || stamp - h.last_active > release_){
+        h.onset = stamp;
+    }
+    h.last_active = stamp;
+
+    if (stamp - h.onset >= hold_){
+        push(cue, data, face, 1, stamp);
+        h.onset = stamp;
+        return true;
+    }
+    return false;
+}
+
+void CueScheduler::push(const std::string &cue, const std::string &data, int face, float value, double stamp){
+    for (unsigned int i = 0; i < pending_.size(); ++i){
+        CueEvent &event = pending_[i];
+        if (event.cue == cue && event.data == data && event.face == face){
+            event.value = value;
+            event.stamp = stamp;
+            event.count++;
+            return;
+        }
+    }
+
+    if (pending_.empty()){
+        first_pending_ = stamp;
+    }
+    CueEvent event;
+    event.cue = cue;
+    event.data = data;
+    event.value = value;
+    event.face = face;
+    event.count = 1;
+    event.stamp = stamp;
+    pending_.push_back(event);
+}
+
+bool CueScheduler::flush(double stamp, std::vector<CueEvent> &batch){
+    std::map<Key, Hysteresis>::iterator it = conditions_.begin();
+    while (it != conditions_.end()){
+        if (stamp - it->second.last_seen > FORGET_TIME){
+            conditions_.erase(it++);
+        }else{
+            ++it;
+        }
+    }
+
+    if (pending_.empty() || stamp - first_pending_ < window_ || stamp - last_flush_ < min_interval_){
+        return false;
+    }
+    batch.swap(pending_);
+    pending_.clear();
+    last_flush_ = stamp;
+    return true;
+}
+
+} // namespace emotional_manager
@@ -0,0 +1,92 @@
+/*
+    Estimates the engagement of the child from the response time, replacing
+    the batch fit of nodes/IRT.py. Each child has its own model, starting
+    from the fit of the population data and refined with every scored
+    answer.
+
+    The model gives P(correct) for a response time, so the outcome of each
+    answer has to come from the interaction through answer_score. Until a
+    score arrives the model of the child is the population fit, it does not
+    adapt without answer_score.
+
+    Subscribes:
+      new_child       (String)  name of the child, selects its model
+      time_response   (Float32) ms till the child writes
+      answer_score    (Float32) score of the last answer, between 0 and 1
+    Publishes:
+      level_engagement (Point)  x between -100 and 100, 0 means P(engaged) = 0.5
+*/
+
+#include "ros/ros.h"
+#include "std_msgs/String.h"
+#include "std_msgs/Float32.h"
+#include "geometry_msgs/Point.h"
+
+#include "emotional_manager/engagement_model.h"
+
+using namespace emotional_manager;
+
+EngagementEstimator *estimator = 0;
+ros::Publisher engagement_pub;
+double last_response = -1;  // Seconds, -1 until a response arrives
+
+void newChildCallback(const std_msgs::String::ConstPtr& msg){
+    estimator->setChild(msg->data);
+    last_response = -1;
+    ROS_INFO("Engagement model of %s: a=%f b=%f", msg->data.c_str(),
+             estimator->model().a(), estimator->model().b());
+}
+
+void responseCallback(const std_msgs::Float32::ConstPtr& msg){
+    // From ms. to s. and get Prob of being engaged
+    last_response = msg->data / 1000;
+    double P_engaged = estimator->model().engagement(last_response);
+
+    // Rescale to have a positive and negative engagement where 0 is 50
+    int engagement_level = int(P_engaged*100);
+    engagement_level = (engagement_level * 2) - 100;
+    ROS_INFO("Response time: %f s, engagement level: %d", last_response, engagement_level);
+
+    geometry_msgs::Point point;
+    point.x = engagement_level;
+    engagement_pub.publish(point);
+}
+
+void scoreCallback(const std_msgs::Float32::ConstPtr& msg){
+    if (last_response < 0){
+        return;
+    }
+    // The best score corresponds to the upper bound of the model
+    EngagementModel &model = estimator->model();
+    model.update(last_response, msg->data * model.upperBound());
+    last_response = -1;
+    ROS_INFO("Engagement model updated: a=%f b=%f (%lu samples)", model.a(), model.b(), model.samples());
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "engagement");
+    ros::NodeHandle n;
+
+    double forgetting;
+    ros::param::param<double>("~forgetting", forgetting, 0.95);
+    std::string population_data;
+    ros::param::param<std::string>("~population_data", population_data, "");
+
+    // Without population data the built-in fit of Hard.csv is used
+    EngagementModel prior(-0.744, 0.460, 0.8, 4.5, forgetting);
+    if (!population_data.empty() && !fitFromCsv(population_data, prior)){
+        ROS_WARN("Cannot read %s, using the default engagement model", population_data.c_str());
+    }
+    EngagementEstimator children(prior);
+    estimator = &children;
+
+    engagement_pub = n.advertise<geometry_msgs::Point>("level_engagement", 10);
+    ros::Subscriber new_child_sub = n.subscribe("new_child", 10, newChildCallback);
+    ros::Subscriber response_sub = n.subscribe("time_response", 10, responseCallback);
+    ros::Subscriber score_sub = n.subscribe("answer_score", 10, scoreCallback);
+
+    ros::spin();
+
+    return 0;
+}
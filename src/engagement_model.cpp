@@ -0,0 +1,132 @@
+#include "emotional_manager/engagement_model.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace emotional_manager {
+
+// Initial uncertainty of the parameters
+static const double INITIAL_COVARIANCE = 1.0;
+// With forgetting the covariance grows when the samples carry little
+// information, bounding it keeps the steps of a and b reasonable.
+static const double MAX_COVARIANCE_TRACE = 2.0;
+// Largest change of a or b after a single answer, the model is far from
+// linear so a full step on an outlier could leave the sigmoid saturated.
+static const double MAX_STEP = 0.1;
+
+EngagementModel::EngagementModel(double a, double b, double u, double L, double forgetting) :
+    a_(a),
+    b_(b),
+    u_(u),
+    L_(L),
+    lambda_(forgetting),
+    samples_(0){
+    P_[0][0] = INITIAL_COVARIANCE; P_[0][1] = 0;
+    P_[1][0] = 0;                  P_[1][1] = INITIAL_COVARIANCE;
+}
+
+double EngagementModel::probabilityCorrect(double rt) const{
+    return u_ / (1 + std::exp(-a_ * (-rt + b_ * L_)));
+}
+
+double EngagementModel::engagement(double rt) const{
+    // Probability of being disengaged: (u - P_corr)/u
+    return probabilityCorrect(rt) / u_;
+}
+
+void EngagementModel::update(double rt, double p_correct){
+    double s = -rt + b_ * L_;
+    double e = std::exp(-a_ * s);
+    double f = u_ / (1 + e);
+
+    // Jacobian of f with respect to (a, b)
+    double g = u_ * e / ((1 + e) * (1 + e));
+    double J[2] = {g * s, g * a_ * L_};
+
+    // Gain K = P J / (lambda + J' P J)
+    double PJ[2] = {P_[0][0]*J[0] + P_[0][1]*J[1],
+                    P_[1][0]*J[0] + P_[1][1]*J[1]};
+    double denom = lambda_ + J[0]*PJ[0] + J[1]*PJ[1];
+    if (!std::isfinite(denom) || denom <= 0){
+        return;
+    }
+    double K[2] = {PJ[0]/denom, PJ[1]/denom};
+
+    double residual = p_correct - f;
+    double step[2] = {K[0] * residual, K[1] * residual};
+    double norm = std::sqrt(step[0]*step[0] + step[1]*step[1]);
+    if (norm > MAX_STEP){
+        step[0] *= MAX_STEP / norm;
+        step[1] *= MAX_STEP / norm;
+    }
+    a_ += step[0];
+    b_ += step[1];
+
+    // P = (P - K J' P) / lambda, P is symmetric so J' P = PJ'
+    for (int i = 0; i < 2; ++i){
+        for (int j = 0; j < 2; ++j){
+            P_[i][j] = (P_[i][j] - K[i]*PJ[j]) / lambda_;
+        }
+    }
+    double trace = P_[0][0] + P_[1][1];
+    if (trace > MAX_COVARIANCE_TRACE){
+        for (int i = 0; i < 2; ++i){
+            for (int j = 0; j < 2; ++j){
+                P_[i][j] *= MAX_COVARIANCE_TRACE / trace;
+            }
+        }
+    }
+    samples_++;
+}
+
+bool fitFromCsv(const std::string &path, EngagementModel &model, int passes){
+    std::ifstream file(path.c_str());
+    if (!file.is_open()){
+        return false;
+    }
+
+    std::vector<double> rts, ps;
+    std::string line;
+    std::getline(file, line);  // Header
+    while (std::getline(file, line)){
+        std::stringstream ss(line);
+        double rt, p;
+        char comma;
+        if (ss >> rt >> comma >> p){
+            rts.push_back(rt);
+            ps.push_back(p);
+        }
+    }
+    if (rts.empty()){
+        return false;
+    }
+
+    // Several passes over the data approximate the batch fit
+    for (int pass = 0; pass < passes; ++pass){
+        for (unsigned int i = 0; i < rts.size(); ++i){
+            model.update(rts[i], ps[i]);
+        }
+    }
+    return true;
+}
+
+EngagementEstimator::EngagementEstimator(const EngagementModel &prior) : prior_(prior), current_(0){
+    setChild("");
+}
+
+void EngagementEstimator::setChild(const std::string &name){
+    std::map<std::string, EngagementModel>::iterator it = children_.find(name);
+    if (it == children_.end()){
+        it = children_.insert(std::make_pair(name, prior_)).first;
+    }
+    child_ = name;
+    current_ = &it->second;
+}
+
+EngagementModel& EngagementEstimator::model(){
+    return *current_;
+}
+
+} // namespace emotional_manager
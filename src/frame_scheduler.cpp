@@ -0,0 +1,100 @@
+#include "emotional_manager/frame_scheduler.h"
+
+#include <algorithm>
+
+namespace emotional_manager {
+
+// Weight of the last frame in the cost estimation
+static const double COST_MU = 0.1;
+// No source is starved below this rate, in frames per second
+static const double MIN_RATE = 0.5;
+
+FrameScheduler::FrameScheduler(double cpu_budget) : cpu_budget_(cpu_budget){
+}
+
+int FrameScheduler::addSource(double max_rate, double weight){
+    std::lock_guard<std::mutex> lock(mutex_);
+    Source source;
+    source.max_rate = max_rate;
+    source.weight = weight > 0.0 ? weight : 1.0;
+    source.cost = 0.0;
+    source.rate = max_rate;
+    source.removed = false;
+    sources_.push_back(source);
+    return int(sources_.size()) - 1;
+}
+
+void FrameScheduler::removeSource(int source){
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_[source].removed = true;
+    rebalance();
+}
+
+void FrameScheduler::frameProcessed(int source, double duration){
+    std::lock_guard<std::mutex> lock(mutex_);
+    Source &s = sources_[source];
+    if (s.cost == 0.0){
+        s.cost = duration;
+    }else{
+        s.cost = COST_MU*duration + (1-COST_MU)*s.cost;
+    }
+    rebalance();
+}
+
+double FrameScheduler::rate(int source) const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sources_[source].rate;
+}
+
+double FrameScheduler::period(int source) const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return 1.0/sources_[source].rate;
+}
+
+void FrameScheduler::rebalance(){
+    // Sources without a cost estimation yet run at their maximum rate
+    std::vector<Source*> active;
+    for (unsigned int i = 0; i < sources_.size(); ++i){
+        if (sources_[i].removed){
+            continue;
+        }
+        if (sources_[i].cost > 0.0){
+            active.push_back(&sources_[i]);
+        }else{
+            sources_[i].rate = sources_[i].max_rate;
+        }
+    }
+
+    // Give its demand to every source needing less than its fair share and
+    // split what remains between the others.
+    double remaining = cpu_budget_;
+    bool changed = true;
+    while (changed && !active.empty()){
+        changed = false;
+        double total_weight = 0.0;
+        for (unsigned int i = 0; i < active.size(); ++i){
+            total_weight += active[i]->weight;
+        }
+        for (unsigned int i = 0; i < active.size(); ++i){
+            double demand = active[i]->cost*active[i]->max_rate;
+            double share = remaining*active[i]->weight/total_weight;
+            if (demand <= share){
+                active[i]->rate = active[i]->max_rate;
+                remaining -= demand;
+                active.erase(active.begin() + i);
+                changed = true;
+                break;
+            }
+        }
+    }
+    double total_weight = 0.0;
+    for (unsigned int i = 0; i < active.size(); ++i){
+        total_weight += active[i]->weight;
+    }
+    for (unsigned int i = 0; i < active.size(); ++i){
+        double share = remaining*active[i]->weight/total_weight;
+        active[i]->rate = std::max(MIN_RATE, share/active[i]->cost);
+    }
+}
+
+} // namespace emotional_manager
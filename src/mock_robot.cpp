@@ -0,0 +1,84 @@
+#include "emotional_manager/robot_interface.h"
+
+namespace emotional_manager {
+
+MockRobot::MockRobot() :
+    commands_(0),
+    preempted_(0),
+    last_colour_(0),
+    motion_id_(0){
+}
+
+void MockRobot::fadeRGB(const std::string &group, uint32_t rgb, float duration){
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_colour_ = rgb;
+    commandReceived();
+}
+
+void MockRobot::setSpeechParameters(float pitch, float volume){
+    std::lock_guard<std::mutex> lock(mutex_);
+    commandReceived();
+}
+
+int MockRobot::postMotion(const MotionCommand &motion){
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The motion lasts until its last keyframe
+    float duration = 0;
+    for (unsigned int i = 0; i < motion.times.size(); ++i){
+        if (!motion.times[i].empty() && motion.times[i].back() > duration){
+            duration = motion.times[i].back();
+        }
+    }
+    motion_id_++;
+    motion_end_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(duration));
+    commandReceived();
+    return motion_id_;
+}
+
+bool MockRobot::isRunning(int motion){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return motion == motion_id_ && Clock::now() < motion_end_;
+}
+
+void MockRobot::stopMotion(int motion){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (motion == motion_id_ && Clock::now() < motion_end_){
+        motion_end_ = Clock::now();
+        preempted_++;
+    }
+    commandReceived();
+}
+
+unsigned long MockRobot::commands() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return commands_;
+}
+
+unsigned long MockRobot::preempted() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return preempted_;
+}
+
+uint32_t MockRobot::lastColour() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_colour_;
+}
+
+MockRobot::Clock::time_point MockRobot::lastCommandTime() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_command_;
+}
+
+void MockRobot::waitForCommands(unsigned long n){
+    std::unique_lock<std::mutex> lock(mutex_);
+    received_.wait(lock, [this, n]{ return commands_ >= n; });
+}
+
+// Called with the mutex locked
+void MockRobot::commandReceived(){
+    commands_++;
+    last_command_ = Clock::now();
+    received_.notify_all();
+}
+
+} // namespace emotional_manager
@@ -18,9 +18,14 @@
 
 #include "ros/ros.h"
 #include "std_msgs/String.h"
-#include "std_msgs/Int16.h"
 #include "std_msgs/Empty.h"
-#include "std_msgs/Float32.h"
+#include "emotional_manager/CueBatch.h"
+#include "emotional_manager/ContactStats.h"
+
+#include "emotional_manager/contact_history.h"
+#include "emotional_manager/cue_scheduler.h"
+#include "emotional_manager/frame_scheduler.h"
+#include "emotional_manager/vision_features.h"
 
 #include <sstream>
 #include <vector>
@@ -29,9 +34,14 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <math.h>
 #include <string>
+#include <stdexcept>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 
 /*
 #include <GL/gl.h>
@@ -39,41 +49,43 @@
 #include <GL/freeglut.h>
 */
 
-#define MAX_COUNT 100
 char imageFileName[32];
 long imageIndex = 0;
 char keyPressed;
-bool contact = true;
 
 using namespace dlib;
 using namespace std;
+using namespace emotional_manager;
+
+// Time given to the last messages to go out before shutting down, in seconds
+static const double STATS_FLUSH_TIME = 0.5;
 
-float t = 1;
-std::vector<float> EMA(6,1);
+// A device which gives no frame for this long is opened again, in seconds
+static const double NO_FRAME_TIMEOUT = 2.0;
+// Times a device is opened again before giving up on it
+static const int MAX_REOPEN = 5;
 
-int look_right_counter = 0;
-int look_left_counter = 0;
-int look_up_counter = 0;
-int look_down_counter = 0;
-int smile_counter = 0;
-int prevSize = 0;
-bool new_child = false;
+// The release of the cues spans at least this many frame periods, a
+// condition seen in consecutive frames is then never interrupted
+static const double RELEASE_PERIODS = 1.5;
+
+std::atomic<int> new_child(0);     // Incremented every time a new child arrives
+std::atomic<bool> running(true);
+std::atomic<int> active_workers(0);
+std::mutex state_mutex;
 string state = " ";
-image_window win;
-
-// Create a dictionary for the markers.
-std::map<string, int> partToPoint = {
-    {"nose", 30},
-    {"right_side", 2},
-    {"left_side", 14},
-    {"eyebrow_right", 21},
-    {"eyebrow_left", 22},
-    {"mouth_up", 51},
-    {"mouth_down", 57},
-    {"mouth_right", 48},
-    {"mouth_left", 54}
-};
 
+// Everything which belongs to one camera source
+struct Camera {
+    string id;
+    string source;
+    int scheduler_id;
+
+    double cue_release;     // Minimum release of the cues, in seconds
+    CueScheduler cue_scheduler;
+    ros::Publisher cues_pub;
+    ros::Publisher contactStats_pub;
+};
 
 double rot[9] = {0};
 std::vector<double> rv(3);
@@ -105,351 +117,144 @@ const std::string currentDateTime() {
     return buf;
 }
 
-// Return the point correspondent to the dictionary marker.
-cv::Point2f getPointFromPart(shape_predictor &pose_model, cv_image<bgr_pixel> &cimg, rectangle face, string name){
-    cv::Point2f point;
-    point.x = pose_model(cimg, face).part(partToPoint[name]).x();
-    point.y = pose_model(cimg, face).part(partToPoint[name]).y();
-
-    return point;
-}
+cv::VideoWriter prepareVideoRecord(cv::VideoCapture &cap, const string &id){
+    double dWidth = cap.get(CV_CAP_PROP_FRAME_WIDTH); //get the width of frames of the video
+    double dHeight = cap.get(CV_CAP_PROP_FRAME_HEIGHT); //get the height of frames of the video
 
-// Returns 1 if the lines intersect, otherwise 0.
-bool get_line_intersection(float p0_x, float p0_y, float p1_x, float p1_y,
-                           float p2_x, float p2_y, float p3_x, float p3_y){
-    float s1_x, s1_y, s2_x, s2_y;
-    s1_x = p1_x - p0_x;     s1_y = p1_y - p0_y;
-    s2_x = p3_x - p2_x;     s2_y = p3_y - p2_y;
+    cout << "Frame Size = " << dWidth << "x" << dHeight << endl;
 
-    float s, t;
-    s = (-s1_y * (p0_x - p2_x) + s1_x * (p0_y - p2_y)) / (-s2_x * s1_y + s1_x * s2_y);
-    t = ( s2_x * (p0_y - p2_y) - s2_y * (p0_x - p2_x)) / (-s2_x * s1_y + s1_x * s2_y);
+    cv::Size frameSize(static_cast<int>(dWidth), static_cast<int>(dHeight));
 
-    if (s >= 0 && s <= 1 && t >= 0 && t <= 1){
-        return 1;
+    //Generate video file name based on the date
+    std::stringstream ss;
+    ss << "/home/ferran/.ros/visionLog/" << currentDateTime();
+    if (!id.empty()){
+        ss << "_" << id;
     }
-    return 0;
-}
+    ss << ".avi";
+    std::string s = ss.str();
 
-// Computes the size of the head consideing the vertical and horizontal segments
-void sizeHead(ros::Publisher sizeHead_pub, shape_predictor &pose_model, cv_image<bgr_pixel> &cimg, rectangle face){
-    // Get up
-    cv::Point2f eyebrow_right = getPointFromPart(pose_model, cimg, face, "eyebrow_right");
-    cv::Point2f eyebrow_left = getPointFromPart(pose_model, cimg, face, "eyebrow_left");
-    cv::Point2f up;
-    up.x = (eyebrow_right.x + eyebrow_left.x);
-    up.y = (eyebrow_right.y + eyebrow_left.y);
+    cv::VideoWriter oVideoWriter (s, CV_FOURCC('D','I','V','X'), 8, frameSize, true); //initialize the VideoWriter object
 
-    // Get right
-    cv::Point2f right = getPointFromPart(pose_model, cimg, face, "right_side");
-    // Get left
-    cv::Point2f left = getPointFromPart(pose_model, cimg, face, "left_side");
-
-    // Compute size of the head
-    float horizontal = sqrt((right.x-left.x)*(right.x-left.x) + (right.y-left.y)*(right.y-left.y));
-    float vertical = sqrt((right.x-up.x)*(right.x-up.x) + (right.y-up.y)*(right.y-up.y));
-    auto size = int((vertical*horizontal)/1000);
-
-    if (abs(prevSize - size)> 5){
-        cout <<"Head size:"<< size << endl;
-        std_msgs::Int16 msgSizeHead;
-        msgSizeHead.data = size;
-        sizeHead_pub.publish(msgSizeHead);
-        prevSize = size;
+    if ( !oVideoWriter.isOpened() ) //if not initialize the VideoWriter successfully, exit the program
+    {
+        cout << "ERROR: Failed to write the video" << endl;
     }
-}
 
-/*
- Detects if someone smiled to the robot. I would be better to
- use Haar detector from openCV depite the computational cost
-*/
-void smileDetector(ros::Publisher smile_pub, shape_predictor &pose_model, cv_image<bgr_pixel> &cimg, rectangle face){
-
-    // Get mouth
-    cv::Point2f mouth_up = getPointFromPart(pose_model, cimg, face, "mouth_up");
-    cv::Point2f mouth_down = getPointFromPart(pose_model, cimg, face, "mouth_down");
-    cv::Point2f mouth_right = getPointFromPart(pose_model, cimg, face, "mouth_right");
-    cv::Point2f mouth_left = getPointFromPart(pose_model, cimg, face, "mouth_left");
-
-    char intersec = 0;
-    intersec = get_line_intersection(mouth_left.x, mouth_left.y, mouth_right.x, mouth_right.y,
-                                     mouth_up.x, mouth_up.y, mouth_down.x, mouth_down.y);
-
-    if (intersec == 0){
-        if (contact==true){
-            smile_counter = smile_counter +1;
-            if(smile_counter>5){
-                cout <<"Someone smiled"<< endl;
-                std_msgs::Empty msgEmpty;
-                smile_pub.publish(msgEmpty);
-                smile_counter = 0;
-            }
-        }
-    }
+    return oVideoWriter;
 }
 
-/* To compute the saliency or novelty, it is necessary to consider all the other features
- * into the EMA value X[]. If the value is greater than the previous EMA with a certain
- * threshold, a novelty has been detected
- */
-void novelty(ros::Publisher novelty_pub, std::vector<bool> lookAt,
-             std::vector<rectangle> faces, float mu, float eps, float threshold){
-
-    std::vector<float> X(6,0);
-    X[0] = float(lookAt[0]);
-    X[1] = float(lookAt[1]);
-    X[2] = float(lookAt[2]);
-    X[3] = float(lookAt[3]);
-    X[4] = float(contact);
-    X[5] = float(faces.size());
-
-    std::vector<float> temp = EMA;
-
-    for (unsigned int j = 0; j < EMA.size(); ++j){
-        EMA[j] = mu*X[j] + (1-mu)*EMA[j];
-    }
-
-    float dist = 0.0;
-
-    for (unsigned int j = 0; j < EMA.size(); ++j){
-        dist += 2*(EMA[j]-temp[j])*(EMA[j]-temp[j]) / ( eps+(EMA[j]+temp[j])*(EMA[j]+temp[j]));
-    }
-    if( dist>threshold){
-        std_msgs::Float32 msgNovelty;
-        cout <<"Novelty detected! :"<< dist*sqrt(t) << endl;
-        msgNovelty.data = dist*sqrt(t);
-        novelty_pub.publish(msgNovelty);
-        t = 1;
-    }
-    else{
-        t++;
-    }
+string currentState(){
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return state;
 }
 
-//TODO: Simplify code in the message sending
-std::vector<bool> lookAt(ros::Publisher lookAt_pub, shape_predictor &pose_model, cv_image<bgr_pixel> &cimg,
-                         rectangle face, std::vector<full_object_detection> &contacts, cv::Mat &rgbFrames){
-    std::vector<bool> lookAt(4);
-    // Get nose
-    cv::Point2f nose = getPointFromPart(pose_model, cimg, face, "nose");
-
-    /*float nose.x = pose_model(cimg, faces[i]).part(30).x();
-    float nose.y = pose_model(cimg, faces[i]).part(30).y();
-    noses.push_back(centered_rect(point(nose.x,nose.y),8,8));*/
-
-    //get rights
-    cv::Point2f right = getPointFromPart(pose_model, cimg, face, "right_side");
-    //get lefts
-    cv::Point2f left = getPointFromPart(pose_model, cimg, face, "left_side");
-
-    float horRight = sqrt((right.x-nose.x)*(right.x-nose.x) + (right.y-nose.y)*(right.y-nose.y));
-    float horLeft = sqrt((left.x-nose.x)*(left.x-nose.x) + (left.y-nose.y)*(left.y-nose.y));
-    float horizontal = sqrt((right.x-left.x)*(right.x-left.x) + (right.y-left.y)*(right.y-left.y));
-    auto estwest = (horRight-horLeft)/horizontal; // -1<score<1
-
-    float l = horRight*horizontal/(horRight+horLeft);
-    float xl = right.x+(left.x-right.x)*l/horizontal;
-    float yl = right.y+(left.y-right.y)*l/horizontal;
-
-    float sh = (yl-nose.y)/abs(nose.y-yl);
-    float h = sqrt((nose.y-yl)*(nose.y-yl) + (nose.x-xl)*(nose.x-xl));
-    float southnorth = sh*h/horRight;
-
-
-    /*//hack for southnord between -1 and 1 :
-    if(southnorth>0){
-        southnorth = southnorth/0.45;
-    }
-    if(southnorth<0){
-        southnorth = southnorth/0.37;
-    }
-
-    southnorth = (3.1415/4)*southnorth;
-    estwest = (3.1415/3)*estwest;
-    cout<< "vert: "<< southnorth << " horz: "<<estwest<<endl;*/
-    //Now, southnord and estwest are radian angles corresponding to the angle of head
-    //angle 0,0 => facing camera
-    //angle pi/3,0 => look left
-    //angle 0,pi/3 => look up
-
-    //Pass to degrees
-    estwest = (estwest*180)/3.1415;
-    southnorth = (southnorth*180)/3.1415;
-    //compute the vector
-    float x = cos(estwest)*cos(southnorth);
-    float y = sin(estwest)*cos(southnorth);
-    float z = sin(southnorth);
-
-    double mult =100;
-    //cv::Point2f nose_ax = nose + cv::Point2f(x,y)*mult;
-    //cv::line(rgbFrames, nose, nose_ax, cv::Scalar(255, 0, 0), 8, 1, 0);
-
+void stateActivityCallback(const std_msgs::String::ConstPtr& msg){
+    std::lock_guard<std::mutex> lock(state_mutex);
+    state = msg->data.c_str();
+}
 
-    bool look_left = estwest>0.3;
-    bool look_right = estwest<-0.3;
-    bool look_up = southnorth>0.3;
-    bool look_down = southnorth<-0.3;
+// The workers publish their session stats before main shuts the node down
+void stopActivityCallback(const std_msgs::Empty::ConstPtr& msg){
+    running = false;
+}
 
-    contact = true;
+void newChildCallback(const std_msgs::String::ConstPtr& msg){
+    new_child++;
+}
 
-    std_msgs::String msg;
-    std::stringstream ss;
+// CPU time used by the calling thread, waiting for the camera or the display does not count
+double threadCpuTime(){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
 
-    if(look_right){
-        smile_counter = 0;
-        look_right_counter = look_right_counter + 1;
-        if (look_right_counter > 5){
-            ss << /*"face " << i <<*/ "right";
-            msg.data = ss.str();
-            ROS_INFO("%s", msg.data.c_str());
-            lookAt_pub.publish(msg);
-            contact=false;
-            look_right_counter = 0;
-        }
-    }
-    if(look_left){
-        smile_counter = 0;
-        look_left_counter = look_left_counter + 1;
-        if (look_left_counter > 5){
-            ss << /*"face " << i <<*/ "left";
-            msg.data = ss.str();
-            ROS_INFO("%s", msg.data.c_str());
-            lookAt_pub.publish(msg);
-            contact=false;
-            look_left_counter = 0;
-        }
-    }
-    if(look_up){
-        smile_counter = 0;
-        look_up_counter = look_up_counter + 1;
-        if (look_up_counter > 5){
-            ss << /*"face " << i <<*/ "robot contact";
-            msg.data = ss.str();
-            ROS_INFO("%s", msg.data.c_str());
-            lookAt_pub.publish(msg);
-            contact=false;
-            look_up_counter = 0;
-        }
+// The source is either the index of a device or the path of a video, e.g.
+// the recordings of this node are named after the date and start with digits
+bool isDevice(const string &source){
+    if (source.empty()){
+        return false;
     }
-    if(look_down){
-        smile_counter = 0;
-        look_down_counter = look_down_counter + 1;
-        if(look_down_counter > 5){
-            ss << /*"face " << i <<*/ "down";
-            msg.data = ss.str();
-            ROS_INFO("%s", msg.data.c_str());
-            lookAt_pub.publish(msg);
-            contact=false;
-            look_down_counter = 0;
+    for (unsigned int i = 0; i < source.size(); ++i){
+        if (!isdigit(source[i])){
+            return false;
         }
     }
-    if(contact){
-        //cout << "contact !!" << endl;
-        contacts.push_back(pose_model(cimg, face));
-    }
-    lookAt[0] = look_right;
-    lookAt[1] = look_left;
-    lookAt[2] = look_up;
-    lookAt[3] = look_down;
-
-    return lookAt;
+    return true;
 }
 
-void amountMovement(ros::Publisher movement_pub, cv::Mat &rgbFrames, cv::Mat &grayFrames, cv::Mat &prevGrayFrame,
-                    cv::Mat &opticalFlow, std::vector<cv::Point2f> &points1, std::vector<cv::Point2f> &points2, bool &needToInit){
-
-    std::vector<uchar> status;
-    std::vector<float> err;
-
-    cv::TermCriteria termcrit(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 20, 0.03);
-    cv::Size winSize(31, 31);
-
-    if (needToInit) {
-        cv::goodFeaturesToTrack(grayFrames, points1, MAX_COUNT, 0.01, 5, cv::Mat(), 3, 0, 0.04);
-        needToInit = false;
-    } else if (!points2.empty()) {
-        cv::calcOpticalFlowPyrLK(prevGrayFrame, grayFrames, points2, points1, status, err, winSize, 3, termcrit, 0, 0.001);
-
-        int x_sum, y_sum = 0;
-
-        int i, k;
-        for (i = k = 0; i < points2.size(); i++) {
-            int x = int(points1[i].x - points2[i].x);
-            int y = int(points1[i].y - points2[i].y);
-
-            x_sum = abs(x) + x_sum;
-            y_sum = abs(y) + y_sum;
-
-            if ((points1[i].x - points2[i].x) > 0) {
-                cv::line(rgbFrames, points1[i], points2[i], cv::Scalar(0, 0, 255), 1, 1, 0);
-                cv::circle(rgbFrames, points1[i], 2, cv::Scalar(255, 0, 0), 1, 1, 0);
-                cv::line(opticalFlow, points1[i], points2[i], cv::Scalar(0, 0, 255), 1, 1, 0);
-                cv::circle(opticalFlow, points1[i], 1, cv::Scalar(255, 0, 0), 1, 1, 0);
-            } else {
-                cv::line(rgbFrames, points1[i], points2[i], cv::Scalar(0, 255, 0), 1, 1, 0);
-                cv::circle(rgbFrames, points1[i], 2, cv::Scalar(255, 0, 0), 1, 1, 0);
-                cv::line(opticalFlow, points1[i], points2[i], cv::Scalar(0, 255, 0), 1, 1, 0);
-                cv::circle(opticalFlow, points1[i], 1, cv::Scalar(255, 0, 0), 1, 1, 0);
-            }
-            points1[k++] = points1[i];
-        }
-        cv::goodFeaturesToTrack(grayFrames, points1, MAX_COUNT, 0.01, 10, cv::Mat(), 3, 0, 0.04);
-
-        if(x_sum + y_sum > 778000){
-            std_msgs::Float32 msgMovement;
-            cout <<"Movement detected! :"<< (x_sum + y_sum) - 830000 << endl;
-            msgMovement.data = (x_sum + y_sum) - 830000;
-            movement_pub.publish(msgMovement);
+// The camera id names the namespace of its topics, so it has to be a valid ROS
+// name: a letter followed by letters, digits or underscores.
+bool isCameraId(const string &id){
+    if (id.empty() || !isalpha(id[0])){
+        return false;
+    }
+    for (unsigned int i = 1; i < id.size(); ++i){
+        if (!isalnum(id[i]) && id[i] != '_'){
+            return false;
         }
     }
+    return true;
 }
 
-cv::VideoWriter prepareVideoRecord(cv::VideoCapture cap){
-    double dWidth = cap.get(CV_CAP_PROP_FRAME_WIDTH); //get the width of frames of the video
-    double dHeight = cap.get(CV_CAP_PROP_FRAME_HEIGHT); //get the height of frames of the video
-
-    cout << "Frame Size = " << dWidth << "x" << dHeight << endl;
-
-    cv::Size frameSize(static_cast<int>(dWidth), static_cast<int>(dHeight));
-
-    //Generate video file name based on the date
-    std::stringstream ss;
-    ss << "/home/ferran/.ros/visionLog/" << currentDateTime() << ".avi";
-    std::string s = ss.str();
-
-    cv::VideoWriter oVideoWriter (s, CV_FOURCC('D','I','V','X'), 8, frameSize, true); //initialize the VideoWriter object
-
-    if ( !oVideoWriter.isOpened() ) //if not initialize the VideoWriter successfully, exit the program
-    {
-        cout << "ERROR: Failed to write the video" << endl;
+bool openSource(cv::VideoCapture &cap, const string &source){
+    if (isDevice(source)){
+        cap.open(atoi(source.c_str()));
+    }else{
+        cap.open(source);
     }
-
-    return oVideoWriter;
+    cap.set(CV_CAP_PROP_FRAME_WIDTH, 640);
+    cap.set(CV_CAP_PROP_FRAME_HEIGHT, 360);
+    return cap.isOpened();
 }
 
-/*This function creates an OpenCV circle per each dlib marker and
-and attach them into the recording videoframe
-*/
-void shapeToPoints(cv::Mat &imgResult, full_object_detection shape){
-
-    cv::Point2f currentPoint;
-    for (unsigned int i = 0; i < 68; i++){
-        currentPoint = cv::Point2f(shape.part(i)(0),shape.part(i)(1));
-        cv::circle(imgResult, cvPoint(currentPoint.x,currentPoint.y),2,CV_RGB(255,0,0),-1,8,0);
-    }
+emotional_manager::FaceContactStats toMessage(int face, const ContactStats &stats){
+    emotional_manager::FaceContactStats msg;
+    msg.face = face;
+    msg.observations = stats.observations;
+    msg.contact_ratio = stats.contactRatio();
+    msg.contact_episodes = stats.contact_episodes;
+    msg.mean_contact = stats.meanContactDuration();
+    msg.direction_counts.assign(stats.direction_counts, stats.direction_counts + GAZE_COUNT);
+    return msg;
 }
 
-void stateActivityCallback(const std_msgs::String::ConstPtr& msg){
-    state = msg->data.c_str();
+// Publishes the aggregated gaze statistics of the session which is finishing
+void publishContactStats(const Camera &camera, const ContactHistory &contacts){
+    ROS_INFO("[%s] Session stats: %s", camera.id.c_str(), contacts.summary().c_str());
+
+    emotional_manager::ContactStats msg;
+    msg.header.stamp = ros::Time::now();
+    msg.header.frame_id = camera.id;
+    msg.session = toMessage(-1, contacts.stats());
+    std::vector<int> faces = contacts.faces();
+    for (unsigned int i = 0; i < faces.size(); ++i){
+        msg.faces.push_back(toMessage(faces[i], contacts.stats(faces[i])));
+    }
+    camera.contactStats_pub.publish(msg);
 }
 
-void stopActivityCallback(const std_msgs::Empty::ConstPtr& msg){
-    ros::shutdown();
-    win.close_window();
-}
+// Publishes the cues gathered by the scheduler of the camera as a single message
+void publishCues(Camera &camera, double stamp){
+    std::vector<CueEvent> batch;
+    if (!camera.cue_scheduler.flush(stamp, batch)){
+        return;
+    }
 
-void newChildCallback(const std_msgs::String::ConstPtr& msg){
-    new_child = true;
+    emotional_manager::CueBatch msg;
+    msg.header.stamp = ros::Time(stamp);
+    msg.header.frame_id = camera.id;
+    for (unsigned int i = 0; i < batch.size(); ++i){
+        emotional_manager::Cue cue;
+        cue.cue = batch[i].cue;
+        cue.data = batch[i].data;
+        cue.value = batch[i].value;
+        cue.face = batch[i].face;
+        cue.count = batch[i].count;
+        msg.cues.push_back(cue);
+    }
+    camera.cues_pub.publish(msg);
 }
 
 //Make a class twoDtoThreeD points
@@ -609,58 +414,25 @@ void newChildCallback(const std_msgs::String::ConstPtr& msg){
 
 
 
-int main(int argc, char **argv)
-{
 
-    /**
-    * The ros::init() function needs to see argc and argv so that it can perform
-    * any ROS arguments and name remapping that were provided at the command line.
-    * The third argument to init() is the name of the node.
-    *
-    * You must call one of the versions of ros::init() before using any other
-    * part of the ROS system.
-    */
-    ros::init(argc, argv, "vision");
-
-    /**
-     * NodeHandle is the main access point to communications with the ROS system.
-     * The first NodeHandle constructed will fully initialize this node, and the last
-     * NodeHandle destructed will close down the node.
-     */
-    ros::NodeHandle n;
-
-    /**
-     * The advertise() function is how you tell ROS that you want to
-     * publish on a given topic name.The second parameter to advertise()
-     * is the size of the message queue
-     */
-    ros::Publisher lookAt_pub = n.advertise<std_msgs::String>("lookAt", 1000);
-    ros::Publisher smile_pub = n.advertise<std_msgs::Empty>("smile", 1000);
-    ros::Publisher movement_pub = n.advertise<std_msgs::Int16>("movement", 1000);
-    ros::Publisher sizeHead_pub = n.advertise<std_msgs::Int16>("sizeHead", 1000);
-    ros::Publisher novelty_pub = n.advertise<std_msgs::Float32>("novelty", 1000);
-    ros::Subscriber state_sub = n.subscribe("state_activity", 1000, stateActivityCallback);
-    ros::Subscriber stop_sub = n.subscribe("stop_learning", 1000, stopActivityCallback);
-    ros::Subscriber new_child_sub = n.subscribe("new_child", 1000, newChildCallback);
-
-    ros::Rate loop_rate(20);
 
+/* Grabs and processes the frames of one camera until the node is stopped,
+ * its window is closed or its source is exhausted. The landmarks model is
+ * shared by all the cameras. The face detector keeps scratch buffers while
+ * scanning, so each camera works on its own copy.
+ */
+void processCamera(Camera &camera, const frontal_face_detector &face_detector,
+                   const shape_predictor &pose_model, FrameScheduler &scheduler, int history_size,
+                   float movement_threshold){
     try
     {
-        ofstream myfile;
-        auto filename = argv[1];
-        myfile.open (filename);
-        std::vector<full_object_detection> contacts;
-        //"/home/ferran/Desktop/GT_ISG/4_Gabriel/2015-05-06_10:50:53.avi"
-        cv::VideoCapture cap(0);
-        cap.set(CV_CAP_PROP_FRAME_WIDTH, 640);
-        cap.set(CV_CAP_PROP_FRAME_HEIGHT, 360);
-
+        frontal_face_detector detector = face_detector;
+        ContactHistory contacts(history_size);
 
-        // Load face detection and pose estimation models.
-        frontal_face_detector detector = get_frontal_face_detector();
-        shape_predictor pose_model;
-        deserialize("shape_predictor_68_face_landmarks.dat") >> pose_model;
+        cv::VideoCapture cap;
+        if (!openSource(cap, camera.source)){
+            throw std::runtime_error("Cannot open the source " + camera.source);
+        }
 
         float threshold = 1;
         float mu = 0.1;
@@ -672,11 +444,44 @@ int main(int argc, char **argv)
         std::vector<cv::Point2f> points1;
         std::vector<cv::Point2f> points2;
         bool needToInit = true;
-        cv::VideoWriter oVideoWriter = prepareVideoRecord(cap);
-
-        // Grab and process frames until the main window is closed by the user.
-        while(!win.is_closed()) {
+        CueState cues;
+        FaceTracker tracker(camera.cue_release);
+        int child = new_child;
+        cv::VideoWriter oVideoWriter = prepareVideoRecord(cap, camera.id);
+
+        image_window win;
+        win.set_title(camera.id);
+        auto last_frame = std::chrono::steady_clock::now();
+        int reopened = 0;
+
+        // Grab and process frames until the window is closed by the user.
+        while(running && !win.is_closed()) {
+            auto start = std::chrono::steady_clock::now();
+            double stamp = ros::Time::now().toSec();
             cap >> frame;
+            if (frame.empty()){
+                if (!isDevice(camera.source)){
+                    ROS_INFO("[%s] End of %s", camera.id.c_str(), camera.source.c_str());
+                    break;
+                }
+                std::chrono::duration<double> waiting = start - last_frame;
+                if (waiting.count() > NO_FRAME_TIMEOUT){
+                    if (reopened == MAX_REOPEN){
+                        ROS_ERROR("[%s] No frame received from %s, giving up", camera.id.c_str(), camera.source.c_str());
+                        break;
+                    }
+                    ROS_WARN("[%s] No frame received, opening %s again", camera.id.c_str(), camera.source.c_str());
+                    cap.release();
+                    openSource(cap, camera.source);
+                    last_frame = std::chrono::steady_clock::now();
+                    reopened++;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            last_frame = start;
+            reopened = 0;
+            double cpu_start = threadCpuTime();
 
             //Resize and crop the boundaries to get 4:3 proportion
             //cv::resize(frame, frame, cv::Size(640, 360), 0, 0, cv::INTER_CUBIC);
@@ -687,15 +492,21 @@ int main(int argc, char **argv)
             cv::cvtColor(rgbFrames, grayFrames, CV_BGR2GRAY);
 
             // Amount of movement using optical flow
-            if(state != "WAITING_FOR_FEEDBACK"){
-                amountMovement(movement_pub, rgbFrames, grayFrames, prevGrayFrame, opticalFlow, points1, points2, needToInit);
+            if(currentState() != "WAITING_FOR_FEEDBACK"){
+                float movement;
+                if(amountMovement(rgbFrames, grayFrames, prevGrayFrame, opticalFlow, points1, points2, needToInit, movement_threshold, movement)){
+                    cout << "[" << camera.id << "] Movement detected! :"<< movement << endl;
+                    camera.cue_scheduler.push("movement", "", -1, movement, stamp);
+                }
             }else{
                 needToInit = true;
             }
 
-            if (new_child == true){
-                oVideoWriter = prepareVideoRecord(cap);
-                new_child = false;
+            if (new_child != child){
+                publishContactStats(camera, contacts);
+                contacts.reset();
+                oVideoWriter = prepareVideoRecord(cap, camera.id);
+                child = new_child;
             }
 
             oVideoWriter << frame;
@@ -713,6 +524,7 @@ int main(int argc, char **argv)
             // Detect faces
 
             std::vector<rectangle> faces = detector(cimg);
+            std::vector<int> ids = tracker.update(faces, stamp);
 
             // Find the pose of each face.
             std::vector<full_object_detection> shapes;
@@ -723,11 +535,34 @@ int main(int argc, char **argv)
                 //Convert to Point2f
                 //shapeToPoints(rgbFrames, shape);
 
-                std::vector<bool> lookTowards;
-                lookTowards = lookAt(lookAt_pub, pose_model, cimg, faces[i], contacts, rgbFrames);
-                sizeHead(sizeHead_pub, pose_model, cimg, faces[i]);
-                smileDetector(smile_pub, pose_model, cimg, faces[i]);
-                novelty(novelty_pub, lookTowards, faces, mu, eps, threshold);
+                // Looking away has to last in time before it is reported
+                Gaze gaze = lookAt(shape);
+                cues.contact = true;
+                for (unsigned int j = 0; j < gaze.lookAt.size(); ++j){
+                    if(camera.cue_scheduler.observe("lookAt", lookAtEvents[j], ids[i], gaze.lookAt[j], stamp)){
+                        ROS_INFO("[%s] face %d %s", camera.id.c_str(), ids[i], lookAtEvents[j]);
+                        cues.contact = false;
+                    }
+                }
+                contacts.record(stamp, ids[i], gaze.direction, gaze.nose.x, gaze.nose.y);
+
+                int size;
+                if(sizeHead(shape, cues, size)){
+                    cout << "[" << camera.id << "] Head size:"<< size << endl;
+                    camera.cue_scheduler.push("sizeHead", "", ids[i], size, stamp);
+                }
+
+                // Only smiles while facing the robot count
+                bool smiling = smileDetector(shape) && gaze.direction == GAZE_CONTACT;
+                if(camera.cue_scheduler.observe("smile", "", ids[i], smiling, stamp)){
+                    cout << "[" << camera.id << "] Someone smiled"<< endl;
+                }
+
+                float noveltyValue;
+                if(novelty(gaze.lookAt, faces.size(), mu, eps, threshold, cues, noveltyValue)){
+                    cout << "[" << camera.id << "] Novelty detected! :"<< noveltyValue << endl;
+                    camera.cue_scheduler.push("novelty", "", -1, noveltyValue, stamp);
+                }
 
                 //3D pose  estimation
                 //calibration(pose_model, cimg, faces[i], rgbFrames);
@@ -735,33 +570,155 @@ int main(int argc, char **argv)
 
             //Lets put the markers to the video
             //oVideoWriter.write(rgbFrames);
-            //Simplify EMA value calulation and make a function
+            // Without faces the EMA decays towards zero, novelties are not published
             if( faces.size() == 0){
-                std::vector<float> X(6,0);
-                auto temp = EMA;
-
-                for (unsigned int j = 0; j < EMA.size(); ++j){
-                    EMA[j] = mu*X[j] + (1-mu)*EMA[j];
-                }
-
-                float dist = 0.0;
-                for (unsigned int j = 0; j < EMA.size(); ++j){
-                    dist += 2*(EMA[j]-temp[j])*(EMA[j]-temp[j]) / ( eps+(EMA[j]+temp[j])*(EMA[j]+temp[j]) );
-                }
-                if( dist>threshold){
-                    //cout <<"novelty ! :"<< dist*sqrt(t) << endl;
-                    t = 1;
-                }
-                else{
-                    t++;
-                }
+                contacts.lost(stamp);
+                float noveltyValue;
+                updateNovelty(std::vector<float>(6,0), mu, eps, threshold, cues, noveltyValue);
             }
 
+            publishCues(camera, stamp);
+
             // Display it all on the screen
             win.clear_overlay();
             win.set_image(cimg);
             win.add_overlay(render_face_detections(shapes));
+
+            // Wait for the next frame allowed by the CPU budget
+            scheduler.frameProcessed(camera.scheduler_id, threadCpuTime() - cpu_start);
+            double period = scheduler.period(camera.scheduler_id);
+            double release = std::max(camera.cue_release, RELEASE_PERIODS*period);
+            camera.cue_scheduler.setRelease(release);
+            tracker.setRetention(release);
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(period));
+        }
+        publishContactStats(camera, contacts);
+    }
+    catch(exception& e)
+    {
+        cout << "[" << camera.id << "] " << e.what() << endl;
+    }
+
+    // The budget of this camera goes to the others, the node stops with the last one
+    scheduler.removeSource(camera.scheduler_id);
+    if (--active_workers == 0){
+        running = false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+
+    /**
+    * The ros::init() function needs to see argc and argv so that it can perform
+    * any ROS arguments and name remapping that were provided at the command line.
+    * The third argument to init() is the name of the node.
+    *
+    * You must call one of the versions of ros::init() before using any other
+    * part of the ROS system.
+    */
+    ros::init(argc, argv, "vision");
+
+    /**
+     * NodeHandle is the main access point to communications with the ROS system.
+     * The first NodeHandle constructed will fully initialize this node, and the last
+     * NodeHandle destructed will close down the node.
+     */
+    ros::NodeHandle n;
+
+    ros::Subscriber state_sub = n.subscribe("state_activity", 1000, stateActivityCallback);
+    ros::Subscriber stop_sub = n.subscribe("stop_learning", 1000, stopActivityCallback);
+    ros::Subscriber new_child_sub = n.subscribe("new_child", 1000, newChildCallback);
+
+    /**
+     * Camera sources as "id:source", where the source is a device index or the path
+     * of a video. With a single camera the cues are published on the global topics,
+     * with several each camera publishes them on its own namespace (e.g. /head/cues).
+     */
+    std::vector<string> sources;
+    ros::param::param<std::vector<string> >("~cameras", sources, std::vector<string>(1, "head:0"));
+    int history_size;
+    ros::param::param<int>("~contact_history_size", history_size, 4096);
+    // Mean displacement of the tracked corners between two frames to report movement, in pixels
+    double movement_threshold;
+    ros::param::param<double>("~movement_threshold", movement_threshold, 3.0);
+    double max_rate;
+    ros::param::param<double>("~max_rate", max_rate, 20.0);
+    double cpu_budget;
+    ros::param::param<double>("~cpu_budget", cpu_budget, std::max(1u, std::thread::hardware_concurrency()));
+
+    // Time-based hysteresis and batching of the cues, in seconds and batches per second
+    double cue_hold, cue_release, cue_window, cue_max_rate;
+    ros::param::param<double>("~cue_hold", cue_hold, 0.3);
+    ros::param::param<double>("~cue_release", cue_release, 0.5);
+    ros::param::param<double>("~cue_window", cue_window, 0.2);
+    ros::param::param<double>("~cue_max_rate", cue_max_rate, 5.0);
+
+    FrameScheduler scheduler(cpu_budget);
+    std::vector<Camera> cameras(sources.size());
+
+    for (unsigned int i = 0; i < sources.size(); ++i){
+        Camera &camera = cameras[i];
+        // Paths may contain colons too, e.g. the time in the name of the recordings
+        // or the scheme of an url (rtsp://...)
+        size_t colon = sources[i].find(':');
+        if (colon == string::npos || !isCameraId(sources[i].substr(0, colon)) ||
+            sources[i].compare(colon + 1, 2, "//") == 0){
+            stringstream ss;
+            ss << "camera" << i;
+            camera.id = ss.str();
+            camera.source = sources[i];
+        }else{
+            camera.id = sources[i].substr(0, colon);
+            camera.source = sources[i].substr(colon + 1);
+        }
+        camera.scheduler_id = scheduler.addSource(max_rate);
+        camera.cue_release = cue_release;
+        camera.cue_scheduler = CueScheduler(cue_hold, cue_release, cue_window, cue_max_rate);
+
+        /**
+         * The advertise() function is how you tell ROS that you want to
+         * publish on a given topic name.The second parameter to advertise()
+         * is the size of the message queue
+         */
+        ros::NodeHandle nh(n, sources.size() > 1 ? camera.id : "");
+        camera.cues_pub = nh.advertise<emotional_manager::CueBatch>("cues", 10);
+        camera.contactStats_pub = nh.advertise<emotional_manager::ContactStats>("contact_stats", 10, true);
+    }
+
+    try
+    {
+        ofstream myfile;
+        auto filename = argv[1];
+        myfile.open (filename);
+
+        // Load face detection and pose estimation models once, they are read-only.
+        frontal_face_detector detector = get_frontal_face_detector();
+        shape_predictor pose_model;
+        deserialize("shape_predictor_68_face_landmarks.dat") >> pose_model;
+
+        std::vector<std::thread> workers;
+        active_workers = cameras.size();
+        for (unsigned int i = 0; i < cameras.size(); ++i){
+            workers.push_back(std::thread(processCamera, std::ref(cameras[i]), std::cref(detector),
+                                          std::cref(pose_model), std::ref(scheduler), history_size,
+                                          float(movement_threshold)));
+        }
+
+        ros::Rate loop_rate(10);
+        while (ros::ok() && running){
             ros::spinOnce();
+            loop_rate.sleep();
+        }
+        running = false;
+
+        for (unsigned int i = 0; i < workers.size(); ++i){
+            workers[i].join();
+        }
+
+        // Give the latched session stats a chance to reach the subscribers
+        if (ros::ok()){
+            ros::Duration(STATS_FLUSH_TIME).sleep();
         }
     }
     catch(serialization_error& e)
@@ -776,5 +733,6 @@ int main(int argc, char **argv)
         cout << e.what() << endl;
     }
 
+    ros::shutdown();
     return 0;
 }
@@ -0,0 +1,343 @@
+#include "emotional_manager/vision_features.h"
+
+#include <opencv2/video/tracking.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <map>
+#include <cmath>
+#include <stdlib.h>
+
+using namespace dlib;
+using namespace std;
+
+namespace emotional_manager {
+
+// Maximum number of corners tracked by the optical flow
+static const int MAX_COUNT = 100;
+
+// Largest face identifier, it has to fit in the int16_t of GazeRecord
+static const int MAX_FACE_ID = 32767;
+
+// Create a dictionary for the markers.
+static const std::map<string, int> partToPoint = {
+    {"nose", 30},
+    {"right_side", 2},
+    {"left_side", 14},
+    {"eyebrow_right", 21},
+    {"eyebrow_left", 22},
+    {"mouth_up", 51},
+    {"mouth_down", 57},
+    {"mouth_right", 48},
+    {"mouth_left", 54}
+};
+
+CueState::CueState() :
+    contact(true),
+    t(1),
+    EMA(6,1),
+    prevSize(0){
+}
+
+const char* const lookAtEvents[4] = {"right", "left", "robot contact", "down"};
+
+FaceTracker::FaceTracker(double retention) :
+    retention_(retention),
+    next_id_(0){
+}
+
+void FaceTracker::setRetention(double retention){
+    retention_ = retention;
+}
+
+int FaceTracker::nextId(){
+    // Skip the identifiers still held by a track, the contact history has
+    // long evicted the old faces when the identifiers wrap around
+    for (;;){
+        int id = next_id_;
+        next_id_ = next_id_ < MAX_FACE_ID ? next_id_ + 1 : 0;
+        bool held = false;
+        for (unsigned int j = 0; j < tracks_.size() && !held; ++j){
+            held = tracks_[j].id == id;
+        }
+        if (!held){
+            return id;
+        }
+    }
+}
+
+std::vector<int> FaceTracker::update(const std::vector<rectangle> &faces, double stamp){
+    // Forget the faces which have not been seen for retention seconds
+    std::vector<Track> tracks;
+    for (unsigned int j = 0; j < tracks_.size(); ++j){
+        if (stamp - tracks_[j].last_seen <= retention_){
+            tracks.push_back(tracks_[j]);
+        }
+    }
+    tracks_.swap(tracks);
+    tracks.clear();
+
+    std::vector<int> ids(faces.size());
+    std::vector<bool> used(tracks_.size(), false);
+
+    for (unsigned int i = 0; i < faces.size(); ++i){
+        // Closest previous face whose center is within half of the face width
+        point center = dlib::center(faces[i]);
+        long best = faces[i].width()*faces[i].width()/4;
+        int match = -1;
+        for (unsigned int j = 0; j < tracks_.size(); ++j){
+            long dist = (dlib::center(tracks_[j].face) - center).length_squared();
+            if (!used[j] && dist <= best){
+                best = dist;
+                match = j;
+            }
+        }
+        if (match >= 0){
+            used[match] = true;
+            ids[i] = tracks_[match].id;
+        }else{
+            ids[i] = nextId();
+        }
+    }
+
+    // Matched tracks move to the new position, the others keep the last one
+    for (unsigned int j = 0; j < tracks_.size(); ++j){
+        if (!used[j]){
+            tracks.push_back(tracks_[j]);
+        }
+    }
+    for (unsigned int i = 0; i < faces.size(); ++i){
+        Track track;
+        track.id = ids[i];
+        track.face = faces[i];
+        track.last_seen = stamp;
+        tracks.push_back(track);
+    }
+    tracks_.swap(tracks);
+    return ids;
+}
+
+cv::Point2f getPointFromPart(const full_object_detection &shape, const string &name){
+    const point &part = shape.part(partToPoint.at(name));
+    return cv::Point2f(part.x(), part.y());
+}
+
+bool get_line_intersection(float p0_x, float p0_y, float p1_x, float p1_y,
+                           float p2_x, float p2_y, float p3_x, float p3_y){
+    float s1_x, s1_y, s2_x, s2_y;
+    s1_x = p1_x - p0_x;     s1_y = p1_y - p0_y;
+    s2_x = p3_x - p2_x;     s2_y = p3_y - p2_y;
+
+    float s, t;
+    s = (-s1_y * (p0_x - p2_x) + s1_x * (p0_y - p2_y)) / (-s2_x * s1_y + s1_x * s2_y);
+    t = ( s2_x * (p0_y - p2_y) - s2_y * (p0_x - p2_x)) / (-s2_x * s1_y + s1_x * s2_y);
+
+    if (s >= 0 && s <= 1 && t >= 0 && t <= 1){
+        return 1;
+    }
+    return 0;
+}
+
+// Computes the size of the head consideing the vertical and horizontal segments
+bool sizeHead(const full_object_detection &shape, CueState &state, int &size){
+    // Get up
+    cv::Point2f eyebrow_right = getPointFromPart(shape, "eyebrow_right");
+    cv::Point2f eyebrow_left = getPointFromPart(shape, "eyebrow_left");
+    cv::Point2f up;
+    up.x = (eyebrow_right.x + eyebrow_left.x);
+    up.y = (eyebrow_right.y + eyebrow_left.y);
+
+    // Get right
+    cv::Point2f right = getPointFromPart(shape, "right_side");
+    // Get left
+    cv::Point2f left = getPointFromPart(shape, "left_side");
+
+    // Compute size of the head
+    float horizontal = sqrt((right.x-left.x)*(right.x-left.x) + (right.y-left.y)*(right.y-left.y));
+    float vertical = sqrt((right.x-up.x)*(right.x-up.x) + (right.y-up.y)*(right.y-up.y));
+    size = int((vertical*horizontal)/1000);
+
+    if (abs(state.prevSize - size)> 5){
+        state.prevSize = size;
+        return true;
+    }
+    return false;
+}
+
+/*
+ Detects if someone smiled to the robot. I would be better to
+ use Haar detector from openCV depite the computational cost
+*/
+bool smileDetector(const full_object_detection &shape){
+
+    // Get mouth
+    cv::Point2f mouth_up = getPointFromPart(shape, "mouth_up");
+    cv::Point2f mouth_down = getPointFromPart(shape, "mouth_down");
+    cv::Point2f mouth_right = getPointFromPart(shape, "mouth_right");
+    cv::Point2f mouth_left = getPointFromPart(shape, "mouth_left");
+
+    char intersec = 0;
+    intersec = get_line_intersection(mouth_left.x, mouth_left.y, mouth_right.x, mouth_right.y,
+                                     mouth_up.x, mouth_up.y, mouth_down.x, mouth_down.y);
+
+    return intersec == 0;
+}
+
+/* To compute the saliency or novelty, it is necessary to consider all the other features
+ * into the EMA value X[]. If the value is greater than the previous EMA with a certain
+ * threshold, a novelty has been detected
+ */
+bool updateNovelty(const std::vector<float> &X, float mu, float eps, float threshold,
+                   CueState &state, float &value){
+
+    std::vector<float> &EMA = state.EMA;
+    std::vector<float> temp = EMA;
+
+    for (unsigned int j = 0; j < EMA.size(); ++j){
+        EMA[j] = mu*X[j] + (1-mu)*EMA[j];
+    }
+
+    float dist = 0.0;
+
+    for (unsigned int j = 0; j < EMA.size(); ++j){
+        dist += 2*(EMA[j]-temp[j])*(EMA[j]-temp[j]) / ( eps+(EMA[j]+temp[j])*(EMA[j]+temp[j]));
+    }
+    if( dist>threshold){
+        value = dist*sqrt(state.t);
+        state.t = 1;
+        return true;
+    }
+    state.t++;
+    return false;
+}
+
+bool novelty(const std::vector<bool> &lookAt, std::size_t nbFaces, float mu, float eps, float threshold,
+             CueState &state, float &value){
+
+    std::vector<float> X(6,0);
+    X[0] = float(lookAt[0]);
+    X[1] = float(lookAt[1]);
+    X[2] = float(lookAt[2]);
+    X[3] = float(lookAt[3]);
+    X[4] = float(state.contact);
+    X[5] = float(nbFaces);
+
+    return updateNovelty(X, mu, eps, threshold, state, value);
+}
+
+Gaze lookAt(const full_object_detection &shape){
+    Gaze gaze;
+    gaze.lookAt.resize(4);
+
+    // Get nose
+    cv::Point2f nose = getPointFromPart(shape, "nose");
+    //get rights
+    cv::Point2f right = getPointFromPart(shape, "right_side");
+    //get lefts
+    cv::Point2f left = getPointFromPart(shape, "left_side");
+
+    float horRight = sqrt((right.x-nose.x)*(right.x-nose.x) + (right.y-nose.y)*(right.y-nose.y));
+    float horLeft = sqrt((left.x-nose.x)*(left.x-nose.x) + (left.y-nose.y)*(left.y-nose.y));
+    float horizontal = sqrt((right.x-left.x)*(right.x-left.x) + (right.y-left.y)*(right.y-left.y));
+    auto estwest = (horRight-horLeft)/horizontal; // -1<score<1
+
+    float l = horRight*horizontal/(horRight+horLeft);
+    float xl = right.x+(left.x-right.x)*l/horizontal;
+    float yl = right.y+(left.y-right.y)*l/horizontal;
+
+    float sh = (yl-nose.y)/abs(nose.y-yl);
+    float h = sqrt((nose.y-yl)*(nose.y-yl) + (nose.x-xl)*(nose.x-xl));
+    float southnorth = sh*h/horRight;
+
+    //Pass to degrees
+    estwest = (estwest*180)/3.1415;
+    southnorth = (southnorth*180)/3.1415;
+
+    bool look_left = estwest>0.3;
+    bool look_right = estwest<-0.3;
+    bool look_up = southnorth>0.3;
+    bool look_down = southnorth<-0.3;
+
+    // Raw gaze direction of this frame
+    gaze.direction = GAZE_CONTACT;
+    if(look_right){
+        gaze.direction = GAZE_RIGHT;
+    }else if(look_left){
+        gaze.direction = GAZE_LEFT;
+    }else if(look_up){
+        gaze.direction = GAZE_UP;
+    }else if(look_down){
+        gaze.direction = GAZE_DOWN;
+    }
+    gaze.nose = nose;
+
+    gaze.lookAt[0] = look_right;
+    gaze.lookAt[1] = look_left;
+    gaze.lookAt[2] = look_up;
+    gaze.lookAt[3] = look_down;
+
+    return gaze;
+}
+
+bool amountMovement(cv::Mat &rgbFrames, cv::Mat &grayFrames, cv::Mat &prevGrayFrame,
+                    cv::Mat &opticalFlow, std::vector<cv::Point2f> &points1, std::vector<cv::Point2f> &points2,
+                    bool &needToInit, float threshold, float &movement){
+
+    std::vector<uchar> status;
+    std::vector<float> err;
+
+    cv::TermCriteria termcrit(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 20, 0.03);
+    cv::Size winSize(31, 31);
+
+    if (needToInit) {
+        cv::goodFeaturesToTrack(grayFrames, points1, MAX_COUNT, 0.01, 5, cv::Mat(), 3, 0, 0.04);
+        needToInit = false;
+    } else if (!points2.empty()) {
+        cv::calcOpticalFlowPyrLK(prevGrayFrame, grayFrames, points2, points1, status, err, winSize, 3, termcrit, 0, 0.001);
+
+        // Displacement of the corners which could be tracked, in pixels
+        float sum = 0;
+        unsigned int tracked = 0;
+
+        unsigned int i, k;
+        for (i = k = 0; i < points2.size(); i++) {
+            if (status[i]){
+                sum += fabs(points1[i].x - points2[i].x) + fabs(points1[i].y - points2[i].y);
+                tracked++;
+            }
+
+            if ((points1[i].x - points2[i].x) > 0) {
+                cv::line(rgbFrames, points1[i], points2[i], cv::Scalar(0, 0, 255), 1, 1, 0);
+                cv::circle(rgbFrames, points1[i], 2, cv::Scalar(255, 0, 0), 1, 1, 0);
+                cv::line(opticalFlow, points1[i], points2[i], cv::Scalar(0, 0, 255), 1, 1, 0);
+                cv::circle(opticalFlow, points1[i], 1, cv::Scalar(255, 0, 0), 1, 1, 0);
+            } else {
+                cv::line(rgbFrames, points1[i], points2[i], cv::Scalar(0, 255, 0), 1, 1, 0);
+                cv::circle(rgbFrames, points1[i], 2, cv::Scalar(255, 0, 0), 1, 1, 0);
+                cv::line(opticalFlow, points1[i], points2[i], cv::Scalar(0, 255, 0), 1, 1, 0);
+                cv::circle(opticalFlow, points1[i], 1, cv::Scalar(255, 0, 0), 1, 1, 0);
+            }
+            points1[k++] = points1[i];
+        }
+        cv::goodFeaturesToTrack(grayFrames, points1, MAX_COUNT, 0.01, 10, cv::Mat(), 3, 0, 0.04);
+
+        if(tracked > 0 && sum/tracked > threshold){
+            movement = sum/tracked;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*This function creates an OpenCV circle per each dlib marker and
+and attach them into the recording videoframe
+*/
+void shapeToPoints(cv::Mat &imgResult, const full_object_detection &shape){
+
+    cv::Point2f currentPoint;
+    for (unsigned int i = 0; i < 68; i++){
+        currentPoint = cv::Point2f(shape.part(i)(0),shape.part(i)(1));
+        cv::circle(imgResult, cvPoint(currentPoint.x,currentPoint.y),2,CV_RGB(255,0,0),-1,8,0);
+    }
+}
+
+} // namespace emotional_manager
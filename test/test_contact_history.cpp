@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "emotional_manager/contact_history.h"
+
+using namespace emotional_manager;
+
+TEST(RingBuffer, OverwritesTheOldest){
+    RingBuffer<int> buffer(3);
+    EXPECT_TRUE(buffer.empty());
+    for (int i = 0; i < 5; ++i){
+        buffer.push(i);
+    }
+    ASSERT_EQ(3u, buffer.size());
+    EXPECT_EQ(2, buffer[0]);
+    EXPECT_EQ(4, buffer.back());
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ContactHistory, AggregatesOutliveTheRecords){
+    ContactHistory history(4);
+    for (int i = 0; i < 10; ++i){
+        history.record(i*0.1, 0, i % 2 ? GAZE_RIGHT : GAZE_CONTACT, 0, 0);
+    }
+    EXPECT_EQ(4u, history.records().size());
+    ContactStats stats = history.stats();
+    EXPECT_EQ(10u, stats.observations);
+    EXPECT_EQ(5u, stats.direction_counts[GAZE_CONTACT]);
+    EXPECT_EQ(5u, stats.direction_counts[GAZE_RIGHT]);
+    EXPECT_DOUBLE_EQ(0.5, stats.contactRatio());
+    EXPECT_EQ(5u, stats.contact_episodes);
+}
+
+TEST(ContactHistory, LookingAwayClosesTheContact){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.5, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.8, 0, GAZE_LEFT, 0, 0);
+    ContactStats stats = history.stats();
+    EXPECT_EQ(1u, stats.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.8, stats.meanContactDuration());
+}
+
+TEST(ContactHistory, GapEndsTheContactWhenLastSeen){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(100.0, 0, GAZE_RIGHT, 0, 0);
+    ContactStats stats = history.stats();
+    EXPECT_EQ(1u, stats.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.0, stats.meanContactDuration());
+
+    // Contact again after a gap starts a new period
+    history.record(200.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(200.5, 0, GAZE_CONTACT, 0, 0);
+    history.record(300.0, 0, GAZE_CONTACT, 0, 0);
+    stats = history.stats();
+    EXPECT_EQ(3u, stats.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.5/3, stats.meanContactDuration());
+}
+
+TEST(ContactHistory, FrameWithoutFacesClosesTheContact){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.5, 0, GAZE_CONTACT, 0, 0);
+    history.lost(0.6);
+    history.lost(50.0);
+    ContactStats stats = history.stats();
+    EXPECT_EQ(1u, stats.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.6, stats.contact_time);
+}
+
+TEST(ContactHistory, OpenContactCountsUntilLastObservation){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.5, 0, GAZE_CONTACT, 0, 0);
+    ContactStats stats = history.stats();
+    EXPECT_EQ(1u, stats.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.5, stats.contact_time);
+}
+
+TEST(ContactHistory, AggregatesPerFace){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.0, 1, GAZE_RIGHT, 0, 0);
+    history.record(0.5, 0, GAZE_CONTACT, 0, 0);
+    history.record(0.5, 1, GAZE_DOWN, 0, 0);
+
+    // The other child looking away does not end the contact of the first one
+    ContactStats first = history.stats(0);
+    EXPECT_DOUBLE_EQ(1.0, first.contactRatio());
+    EXPECT_EQ(1u, first.contact_episodes);
+    EXPECT_DOUBLE_EQ(0.5, first.contact_time);
+
+    ContactStats second = history.stats(1);
+    EXPECT_EQ(2u, second.observations);
+    EXPECT_DOUBLE_EQ(0.0, second.contactRatio());
+    EXPECT_EQ(0u, second.contact_episodes);
+
+    EXPECT_EQ(4u, history.stats().observations);
+    EXPECT_EQ(0u, history.stats(7).observations);
+
+    std::vector<int> faces = history.faces();
+    ASSERT_EQ(2u, faces.size());
+    EXPECT_EQ(0, faces[0]);
+    EXPECT_EQ(1, faces[1]);
+}
+
+TEST(ContactHistory, ResetForgetsEverything){
+    ContactHistory history(16, 1.0);
+    history.record(0.0, 0, GAZE_CONTACT, 0, 0);
+    history.reset();
+    EXPECT_TRUE(history.records().empty());
+    EXPECT_EQ(0u, history.stats().observations);
+    EXPECT_EQ(0u, history.stats().contact_episodes);
+    EXPECT_EQ(0u, history.stats(0).observations);
+}
+
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "emotional_manager/cue_scheduler.h"
+
+using namespace emotional_manager;
+
+// 16 frames per second, the stamps are exact in binary
+static const double PERIOD = 0.0625;
+
+// Observes the condition once per frame in [first, last], returns when it fired
+static std::vector<double> observeFrames(CueScheduler &scheduler, const std::string &data, int face,
+                                         bool active, int first, int last){
+    std::vector<double> fired;
+    for (int frame = first; frame <= last; ++frame){
+        if (scheduler.observe("lookAt", data, face, active, frame*PERIOD)){
+            fired.push_back(frame*PERIOD);
+        }
+    }
+    return fired;
+}
+
+TEST(CueScheduler, FiresAfterHold){
+    CueScheduler scheduler(0.25, 0.1875, 0.2, 5.0);
+    std::vector<double> fired = observeFrames(scheduler, "right", 0, true, 0, 16);
+    // It has to last another hold to fire again
+    ASSERT_EQ(4u, fired.size());
+    EXPECT_DOUBLE_EQ(0.25, fired[0]);
+    EXPECT_DOUBLE_EQ(0.5, fired[1]);
+    EXPECT_DOUBLE_EQ(1.0, fired[3]);
+}
+
+TEST(CueScheduler, ShortGapDoesNotInterrupt){
+    CueScheduler scheduler(0.25, 0.1875, 0.2, 5.0);
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, true, 0, 2).empty());
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, false, 3, 4).empty());
+    std::vector<double> fired = observeFrames(scheduler, "right", 0, true, 5, 5);
+    ASSERT_EQ(1u, fired.size());
+    EXPECT_DOUBLE_EQ(0.3125, fired[0]);
+}
+
+TEST(CueScheduler, LongInactivityResets){
+    CueScheduler scheduler(0.25, 0.1875, 0.2, 5.0);
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, true, 0, 2).empty());
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, false, 3, 6).empty());
+    std::vector<double> fired = observeFrames(scheduler, "right", 0, true, 7, 12);
+    ASSERT_EQ(1u, fired.size());
+    EXPECT_DOUBLE_EQ(0.6875, fired[0]);
+}
+
+TEST(CueScheduler, GapWithoutObservationsResets){
+    // The face is not detected between 0.1875 s and 2.1875 s
+    CueScheduler scheduler(0.25, 0.125, 0.2, 5.0);
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, true, 0, 3).empty());
+    std::vector<double> fired = observeFrames(scheduler, "right", 0, true, 35, 40);
+    ASSERT_EQ(1u, fired.size());
+    EXPECT_DOUBLE_EQ(2.4375, fired[0]);
+}
+
+TEST(CueScheduler, ConditionsArePerFaceAndCue){
+    CueScheduler scheduler(0.25, 0.1875, 0.2, 5.0);
+    EXPECT_TRUE(observeFrames(scheduler, "right", 0, true, 0, 2).empty());
+    EXPECT_TRUE(observeFrames(scheduler, "left", 0, true, 3, 5).empty());
+    EXPECT_TRUE(observeFrames(scheduler, "right", 1, true, 3, 5).empty());
+    std::vector<double> fired = observeFrames(scheduler, "right", 0, true, 3, 5);
+    ASSERT_EQ(1u, fired.size());
+    EXPECT_DOUBLE_EQ(0.25, fired[0]);
+}
+
+TEST(CueScheduler, FlushWaitsForTheWindow){
+    CueScheduler scheduler(0.3, 0.1, 0.2, 5.0);
+    std::vector<CueEvent> batch;
+    EXPECT_FALSE(scheduler.flush(0.0, batch));
+    scheduler.push("movement", "", -1, 10, 0.0);
+    EXPECT_FALSE(scheduler.flush(0.1, batch));
+    EXPECT_TRUE(scheduler.flush(0.2, batch));
+    ASSERT_EQ(1u, batch.size());
+    EXPECT_EQ("movement", batch[0].cue);
+    EXPECT_FALSE(scheduler.flush(0.5, batch));
+}
+
+TEST(CueScheduler, MergesRepeatedEvents){
+    CueScheduler scheduler(0.3, 0.1, 0.2, 5.0);
+    std::vector<CueEvent> batch;
+    scheduler.push("movement", "", -1, 10, 0.0);
+    scheduler.push("movement", "", -1, 20, 0.05);
+    scheduler.push("movement", "", -1, 30, 0.1);
+    scheduler.push("sizeHead", "", 3, 95, 0.1);
+    ASSERT_TRUE(scheduler.flush(0.2, batch));
+    ASSERT_EQ(2u, batch.size());
+    EXPECT_EQ(3u, batch[0].count);
+    EXPECT_FLOAT_EQ(30, batch[0].value);
+    EXPECT_DOUBLE_EQ(0.1, batch[0].stamp);
+    EXPECT_EQ(1u, batch[1].count);
+    EXPECT_EQ(3, batch[1].face);
+}
+
+TEST(CueScheduler, FollowsTheFramePeriod){
+    // At 0.5 fps every gap is longer than the default release
+    CueScheduler scheduler(0.3, 0.5, 0.2, 5.0);
+    EXPECT_FALSE(scheduler.observe("smile", "", 0, true, 0.0));
+    EXPECT_FALSE(scheduler.observe("smile", "", 0, true, 2.0));
+    EXPECT_FALSE(scheduler.observe("smile", "", 0, true, 4.0));
+
+    scheduler.setRelease(3.0);
+    EXPECT_FALSE(scheduler.observe("smile", "", 1, true, 0.0));
+    EXPECT_TRUE(scheduler.observe("smile", "", 1, true, 2.0));
+}
+
+TEST(CueScheduler, LimitsTheRate){
+    CueScheduler scheduler(0.3, 0.1, 0.0, 5.0);
+    std::vector<CueEvent> batch;
+    scheduler.push("novelty", "", -1, 1, 0.0);
+    EXPECT_TRUE(scheduler.flush(0.0, batch));
+    scheduler.push("novelty", "", -1, 1, 0.1);
+    EXPECT_FALSE(scheduler.flush(0.1, batch));
+    EXPECT_FALSE(scheduler.flush(0.15, batch));
+    EXPECT_TRUE(scheduler.flush(0.2, batch));
+    EXPECT_EQ(1u, batch.size());
+}
+
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "emotional_manager/engagement_model.h"
+
+using namespace emotional_manager;
+
+TEST(EngagementModel, EngagementIsTheNormalizedProbability){
+    EngagementModel model;
+    for (double rt = 0; rt < 10; rt += 0.5){
+        double p = model.probabilityCorrect(rt);
+        EXPECT_GT(p, 0);
+        EXPECT_LT(p, model.upperBound());
+        EXPECT_DOUBLE_EQ(p/model.upperBound(), model.engagement(rt));
+    }
+}
+
+TEST(EngagementModel, AdaptsToTheChild){
+    // Answers of a child following other parameters
+    EngagementModel child(-1.2, 0.8);
+    EngagementModel model;
+    double before = std::fabs(model.probabilityCorrect(3) - child.probabilityCorrect(3));
+    for (int pass = 0; pass < 50; ++pass){
+        for (double rt = 1; rt <= 8; rt += 1){
+            model.update(rt, child.probabilityCorrect(rt));
+        }
+    }
+    double after = std::fabs(model.probabilityCorrect(3) - child.probabilityCorrect(3));
+    EXPECT_LT(after, before/4);
+    EXPECT_EQ(400u, model.samples());
+}
+
+TEST(EngagementModel, OutliersKeepTheModelBounded){
+    EngagementModel model;
+    for (int i = 0; i < 1000; ++i){
+        double a = model.a(), b = model.b();
+        model.update(i % 2 ? 0.1 : 9.0, i % 2 ? 0.0 : 0.8);
+        EXPECT_TRUE(std::isfinite(model.a()));
+        EXPECT_TRUE(std::isfinite(model.b()));
+        EXPECT_LE(std::hypot(model.a() - a, model.b() - b), 0.1 + 1e-12);
+    }
+}
+
+TEST(EngagementModel, FitsACsvFile){
+    const char *path = "test_engagement_model.csv";
+    std::ofstream file(path);
+    file << "rt,P\n2,0.39\n3,0.54\n4,0.66\n6,0.77\n";
+    file.close();
+
+    EngagementModel model(-0.1, -0.1);
+    ASSERT_TRUE(fitFromCsv(path, model));
+    EXPECT_NEAR(0.54, model.probabilityCorrect(3), 0.1);
+    EXPECT_NEAR(0.77, model.probabilityCorrect(6), 0.1);
+    std::remove(path);
+
+    EXPECT_FALSE(fitFromCsv("missing.csv", model));
+}
+
+TEST(EngagementEstimator, KeepsOneModelPerChild){
+    EngagementEstimator estimator;
+    estimator.setChild("anna");
+    for (int i = 0; i < 20; ++i){
+        estimator.model().update(2, 0.8);
+    }
+    double a = estimator.model().a();
+
+    estimator.setChild("bob");
+    EXPECT_EQ(0u, estimator.model().samples());
+    EXPECT_DOUBLE_EQ(EngagementModel().a(), estimator.model().a());
+
+    estimator.setChild("anna");
+    EXPECT_EQ("anna", estimator.child());
+    EXPECT_EQ(20u, estimator.model().samples());
+    EXPECT_DOUBLE_EQ(a, estimator.model().a());
+}
+
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
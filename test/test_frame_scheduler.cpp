@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include "emotional_manager/frame_scheduler.h"
+
+using namespace emotional_manager;
+
+TEST(FrameScheduler, MaximumRateWithinBudget){
+    FrameScheduler scheduler(1.0);
+    int a = scheduler.addSource(10);
+    int b = scheduler.addSource(10);
+    EXPECT_DOUBLE_EQ(10, scheduler.rate(a));
+    scheduler.frameProcessed(a, 0.01);
+    scheduler.frameProcessed(b, 0.01);
+    EXPECT_DOUBLE_EQ(10, scheduler.rate(a));
+    EXPECT_DOUBLE_EQ(10, scheduler.rate(b));
+    EXPECT_DOUBLE_EQ(0.1, scheduler.period(b));
+}
+
+TEST(FrameScheduler, SplitsTheBudgetByWeight){
+    FrameScheduler scheduler(1.0);
+    int a = scheduler.addSource(20);
+    int b = scheduler.addSource(20, 3.0);
+    scheduler.frameProcessed(a, 0.1);
+    scheduler.frameProcessed(b, 0.1);
+    EXPECT_DOUBLE_EQ(2.5, scheduler.rate(a));
+    EXPECT_DOUBLE_EQ(7.5, scheduler.rate(b));
+}
+
+TEST(FrameScheduler, UnusedShareGoesToTheOthers){
+    FrameScheduler scheduler(1.0);
+    int cheap = scheduler.addSource(20);
+    int costly = scheduler.addSource(20);
+    scheduler.frameProcessed(cheap, 0.01);
+    scheduler.frameProcessed(costly, 0.1);
+    EXPECT_DOUBLE_EQ(20, scheduler.rate(cheap));
+    EXPECT_DOUBLE_EQ(8, scheduler.rate(costly));
+}
+
+TEST(FrameScheduler, RemovedSourceReleasesItsShare){
+    FrameScheduler scheduler(1.0);
+    int a = scheduler.addSource(20);
+    int b = scheduler.addSource(20);
+    scheduler.frameProcessed(a, 0.1);
+    scheduler.frameProcessed(b, 0.1);
+    EXPECT_DOUBLE_EQ(5, scheduler.rate(b));
+    scheduler.removeSource(a);
+    EXPECT_DOUBLE_EQ(10, scheduler.rate(b));
+}
+
+TEST(FrameScheduler, NoSourceIsStarved){
+    FrameScheduler scheduler(0.1);
+    int a = scheduler.addSource(20);
+    scheduler.frameProcessed(a, 1.0);
+    EXPECT_DOUBLE_EQ(0.5, scheduler.rate(a));
+}
+
+TEST(FrameScheduler, CostIsSmoothed){
+    FrameScheduler scheduler(1.0);
+    int a = scheduler.addSource(20);
+    scheduler.frameProcessed(a, 0.1);
+    scheduler.frameProcessed(a, 1.1);
+    // Cost 0.1*1.1 + 0.9*0.1 = 0.2
+    EXPECT_NEAR(5, scheduler.rate(a), 1e-9);
+}
+
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}